@@ -0,0 +1,80 @@
+#include "share_matrix.h"
+#include "unary_outer_product.h"
+
+#include <iostream>
+#include <chrono>
+
+
+// Measures the per-call cost of a single one-hot product over a range of
+// shapes, both dispatched to the worker threads and computed inline. The work
+// (2^n * m hashes) at which the two columns cross is a good value for
+// `inline_threshold()`.
+
+
+// A link that drops everything sent and receives zeros. Neither party's output
+// is meaningful, but both do exactly the work they would over a real link.
+struct NullLink : public Link {
+  void send(std::span<const std::byte>) { }
+  void recv(std::span<std::byte> s) { std::fill(s.begin(), s.end(), std::byte { 0 }); }
+  void flush() { }
+};
+
+
+template <typename F>
+auto timed(F f) {
+  auto start = std::chrono::high_resolution_clock::now();
+  f();
+  auto finish = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = finish - start;
+  return elapsed.count();
+}
+
+
+template <Mode mode>
+double per_call(std::size_t n, std::size_t m, std::size_t threshold, std::size_t reps) {
+  IdentityTable id;
+  const ShareMatrix<mode> x(n, 1);
+  const ShareMatrix<mode> y(m, 1);
+  ShareMatrix<mode> out(n, m);
+
+  inline_threshold() = threshold;
+  return timed([&] {
+    for (std::size_t i = 0; i < reps; ++i) {
+      unary_outer_product<mode>(id, x, y, out);
+    }
+  }) / reps;
+}
+
+
+int main(int argc, char** argv) {
+  std::size_t reps = argc > 1 ? atoi(argv[1]) : 1000;
+
+  NullLink link;
+  *the_link() = &link;
+
+  PRG prg;
+  Share<Mode::G>::initialize(prg(), prg());
+  Share<Mode::E>::initialize(prg(), prg());
+  initialize_gjobs();
+  initialize_ejobs();
+
+  const auto saved = inline_threshold();
+
+  std::cout << "n,m,work,g_threaded_us,g_inline_us,e_threaded_us,e_inline_us\n";
+  for (std::size_t n = 1; n <= 8; ++n) {
+    for (std::size_t m = 1; m <= 256; m *= 2) {
+      const auto g_threaded = per_call<Mode::G>(n, m, 0, reps);
+      const auto g_inline = per_call<Mode::G>(n, m, -1, reps);
+      const auto e_threaded = per_call<Mode::E>(n, m, 0, reps);
+      const auto e_inline = per_call<Mode::E>(n, m, -1, reps);
+      std::cout << n << ',' << m << ',' << (m << n) << ','
+        << g_threaded * 1e6 << ',' << g_inline * 1e6 << ','
+        << e_threaded * 1e6 << ',' << e_inline * 1e6 << '\n';
+    }
+  }
+
+  inline_threshold() = saved;
+
+  finalize_gjobs();
+  finalize_ejobs();
+}
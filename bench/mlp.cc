@@ -0,0 +1,193 @@
+#include "fixed_point.h"
+#include "net_link.h"
+#include "measure_link.h"
+
+#include <iostream>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <thread>
+
+
+// Garbles inference of a small fully connected network,
+//   y = sigmoid(W2 relu(W1 x + b1) + b2),
+// in 16-bit fixed point, and reports the time, the bytes sent from G to E,
+// and the largest error against the same network evaluated in double
+// precision.
+//
+// usage: mlp [<seed> [<channels>]]
+// With channels, the workers stream one-hot products over that many extra
+// connections, on the ports after the main one.
+
+
+constexpr std::size_t inputs = 16;
+constexpr std::size_t hidden = 16;
+constexpr std::size_t outputs = 4;
+
+
+template <Mode mode> using Num = Fixed16<mode>;
+
+
+struct Model {
+  std::vector<std::vector<double>> w1, w2;
+  std::vector<double> b1, b2;
+  std::vector<double> x;
+};
+
+
+Model random_model(std::size_t seed) {
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> d(-1, 1);
+  const auto matrix = [&](std::size_t n, std::size_t m) {
+    std::vector<std::vector<double>> out(n, std::vector<double>(m));
+    for (auto& row: out) { for (auto& v: row) { v = d(rng) / 2; } }
+    return out;
+  };
+  const auto vector = [&](std::size_t n) {
+    std::vector<double> out(n);
+    for (auto& v: out) { v = d(rng); }
+    return out;
+  };
+  return { matrix(hidden, inputs), matrix(outputs, hidden), vector(hidden), vector(outputs), vector(inputs) };
+}
+
+
+// G's secret input: a uniform share whose color G sets to the value.
+template <Mode mode>
+Num<mode> secret(double v) {
+  const auto u = ShareMatrix<mode>::uniform(Num<mode>::width, 1);
+  return Num<mode> { Num<mode>::constant(v).matrix() ^ u ^ ShareMatrix<mode>::constant(color<mode>(u)) };
+}
+
+
+template <Mode mode>
+std::vector<Num<mode>> dense(
+    const std::vector<std::vector<double>>& w,
+    const std::vector<double>& b,
+    const std::vector<Num<mode>>& x) {
+  std::vector<Num<mode>> out;
+  for (std::size_t i = 0; i < w.size(); ++i) {
+    auto acc = secret<mode>(b[i]);
+    for (std::size_t j = 0; j < x.size(); ++j) {
+      acc = acc + secret<mode>(w[i][j]) * x[j];
+    }
+    out.push_back(acc);
+  }
+  return out;
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> infer(const Model& model) {
+  std::vector<Num<mode>> x;
+  for (const auto v: model.x) { x.push_back(secret<mode>(v)); }
+
+  auto h = dense<mode>(model.w1, model.b1, x);
+  for (auto& v: h) { v = relu(v); }
+  auto y = dense<mode>(model.w2, model.b2, h);
+  for (auto& v: y) { v = sigmoid(v); }
+
+  auto out = ShareMatrix<mode>(Num<mode>::width, outputs);
+  for (std::size_t j = 0; j < outputs; ++j) {
+    const auto m = y[j].matrix();
+    for (std::size_t i = 0; i < Num<mode>::width; ++i) { out(i, j) = m[i]; }
+  }
+  return out;
+}
+
+
+std::vector<double> plaintext(const Model& model) {
+  const auto dense = [](const auto& w, const auto& b, const auto& x) {
+    std::vector<double> out(b);
+    for (std::size_t i = 0; i < w.size(); ++i) {
+      for (std::size_t j = 0; j < x.size(); ++j) { out[i] += w[i][j] * x[j]; }
+    }
+    return out;
+  };
+  auto h = dense(model.w1, model.b1, model.x);
+  for (auto& v: h) { v = std::max(v, 0.0); }
+  auto y = dense(model.w2, model.b2, h);
+  for (auto& v: y) { v = sigmoid_fn(v); }
+  return y;
+}
+
+
+int main(int argc, char** argv) {
+  const std::size_t seed = argc > 1 ? atoi(argv[1]) : 0;
+  const std::size_t n_channels = argc > 2 ? atoi(argv[2]) : 0;
+  constexpr int port = 11112;
+  const auto model = random_model(seed);
+
+  PRG prg;
+  const auto key = prg();
+  const auto seed_g = prg();
+
+  Matrix result;
+  std::size_t bytes = 0;
+  std::ostringstream phases;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+
+  std::thread th { [&] {
+    GT::NetLink link { nullptr, port };
+    MeasureLink<GT::NetLink> mlink { &link };
+    *the_link() = &mlink;
+
+    std::vector<std::unique_ptr<GT::NetLink>> channels;
+    std::vector<std::unique_ptr<MeasureLink<GT::NetLink>>> mchannels;
+    std::vector<Link*> links;
+    for (std::size_t k = 0; k < n_channels; ++k) {
+      channels.push_back(std::make_unique<GT::NetLink>(nullptr, port + 1 + k));
+      mchannels.push_back(std::make_unique<MeasureLink<GT::NetLink>>(channels.back().get()));
+      links.push_back(mchannels.back().get());
+    }
+
+    Share<Mode::G>::initialize(key, seed_g);
+    initialize_gjobs(links);
+    infer<Mode::G>(model).decode_to_evaluator();
+    finalize_gjobs();
+
+    mlink.flush();
+    bytes = mlink.count();
+    for (const auto& c: mchannels) { bytes += c->count(); }
+    mlink.write_json(phases);
+  } };
+
+  {
+    GT::NetLink link { "127.0.0.1", port };
+    *the_link() = &link;
+
+    std::vector<std::unique_ptr<GT::NetLink>> channels;
+    std::vector<Link*> links;
+    for (std::size_t k = 0; k < n_channels; ++k) {
+      channels.push_back(std::make_unique<GT::NetLink>("127.0.0.1", port + 1 + k));
+      links.push_back(channels.back().get());
+    }
+
+    Share<Mode::E>::initialize(key, seed_g);
+    initialize_ejobs(links);
+    result = infer<Mode::E>(model).decode_to_evaluator();
+    finalize_ejobs();
+  }
+
+  th.join();
+
+  const auto finish = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = finish - start;
+
+  const auto expected = plaintext(model);
+  double error = 0;
+  for (std::size_t j = 0; j < outputs; ++j) {
+    auto column = Matrix::vector(Num<Mode::G>::width);
+    for (std::size_t i = 0; i < Num<Mode::G>::width; ++i) { column[i] = result(i, j); }
+    error = std::max(error, std::abs(Num<Mode::G>::decode(column) - expected[j]));
+  }
+
+  std::cout << "channels: " << n_channels << '\n';
+  std::cout << "layers: " << inputs << " -> " << hidden << " -> " << outputs << '\n';
+  std::cout << "seconds: " << elapsed.count() << '\n';
+  std::cout << "GC size in bytes: " << bytes << '\n';
+  std::cout << "max error: " << error << '\n';
+  std::cout << "G phases: " << phases.str() << '\n';
+}
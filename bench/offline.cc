@@ -0,0 +1,90 @@
+#include "integer.h"
+#include "file_link.h"
+
+#include <iostream>
+#include <chrono>
+
+
+// Garbles a chain of 32-bit multiplications offline into a file, then
+// evaluates it from a memory mapping of that file, and reports the time of
+// each phase, the file size, and whether the output decodes correctly. G's
+// decoding bits for the output are the last thing in the file.
+//
+// usage: offline <garbled file> [<multiplications>]
+
+
+template <typename F>
+auto timed(F f) {
+  auto start = std::chrono::high_resolution_clock::now();
+  f();
+  auto finish = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = finish - start;
+  return elapsed.count();
+}
+
+
+// G's secret input: a uniform share whose color G sets to the value.
+template <Mode mode>
+ShareMatrix<mode> secret(std::uint32_t v) {
+  const auto u = ShareMatrix<mode>::uniform(32, 1);
+  return ShareMatrix<mode>::constant(from_uint32(v)) ^ u ^ ShareMatrix<mode>::constant(color<mode>(u));
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> chain(std::size_t reps) {
+  const auto x = secret<mode>(0x9e3779b9);
+  auto acc = secret<mode>(1);
+  for (std::size_t i = 0; i < reps; ++i) {
+    MatrixView<const Share<mode>> a = acc;
+    MatrixView<const Share<mode>> b = x;
+    acc = integer_multiply<mode>(a, b);
+  }
+  return acc;
+}
+
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <garbled file> [<multiplications>]\n";
+    std::exit(1);
+  }
+  const char* path = argv[1];
+  const std::size_t reps = argc > 2 ? atoi(argv[2]) : 1000;
+
+  PRG prg;
+  const auto key = prg();
+  const auto seed = prg();
+
+  Matrix result;
+  std::size_t bytes = 0;
+
+  const auto garble = timed([&] {
+    FileLink link { path };
+    *the_link() = &link;
+    Share<Mode::G>::initialize(key, seed);
+    initialize_gjobs();
+    chain<Mode::G>(reps).decode_to_evaluator(true);
+    finalize_gjobs();
+    link.flush();
+    bytes = link.size();
+  });
+
+  const auto evaluate = timed([&] {
+    MmapLink link { path };
+    *the_link() = &link;
+    Share<Mode::E>::initialize(key, seed);
+    initialize_ejobs();
+    result = chain<Mode::E>(reps).decode_to_evaluator(true);
+    finalize_ejobs();
+  });
+
+  std::uint32_t expected = 1;
+  for (std::size_t i = 0; i < reps; ++i) { expected *= 0x9e3779b9; }
+
+  std::cout << "multiplications: " << reps << '\n';
+  std::cout << "garbled file bytes: " << bytes << '\n';
+  std::cout << "offline garbling seconds: " << garble << '\n';
+  std::cout << "online evaluation seconds: " << evaluate << '\n';
+  std::cout << "correct: " << (to_uint32(result) == expected) << '\n';
+}
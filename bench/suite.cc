@@ -0,0 +1,257 @@
+#include "bench_cases.h"
+#include "unary_outer_product.h"
+#include "transcript_link.h"
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+
+
+// Runs every registered gadget (or those named) in its naive and one-hot
+// versions, sweeping chunk sizes and worker thread counts for the one-hot
+// version; the naive version uses neither, so it runs once. Cases that lack
+// one of the two versions skip it. As in
+// `transcript`, G garbles into an in-memory transcript and E then evaluates
+// it, so times are pure computation. Each measurement first runs a warm-up
+// batch of operations that is not counted, to take thread start-up, cold
+// caches and page faults out of the per-operation figures.
+//
+// With --check, every measurement is followed by a few operations on random
+// inputs whose outputs are opened to E and compared with the case's cleartext
+// reference; a mismatch is an error. The checks run after the clock stops, on
+// a fresh transcript, so they do not change the reported numbers.
+//
+// usage: suite [--json] [--check] [--reps <n>] [--warmup <n>]
+//              [--chunks <a,b,...>] [--threads <a,b,...>] [<case>...]
+
+
+template <typename F>
+auto timed(F f) {
+  auto start = std::chrono::high_resolution_clock::now();
+  f();
+  auto finish = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = finish - start;
+  return elapsed.count();
+}
+
+
+struct Result {
+  const char* name;
+  bool naive;
+  std::size_t chunk;
+  std::size_t threads;
+  std::size_t reps;
+  double garble_us;
+  double evaluate_us;
+  double bytes;
+  double g_hashes;
+  double e_hashes;
+  bool checked;
+};
+
+
+constexpr std::size_t checks_per_measurement = 4;
+
+std::mt19937_64 check_rng;
+
+
+std::vector<std::size_t> parse_list(const char* s) {
+  std::vector<std::size_t> out;
+  std::istringstream in { s };
+  std::string item;
+  while (std::getline(in, item, ',')) { out.push_back(std::stoul(item)); }
+  return out;
+}
+
+
+Result measure(
+    TranscriptLink& link,
+    const BenchCase& c, bool naive, std::size_t reps, std::size_t warmup) {
+  PRG prg;
+  const auto key = prg();
+  const auto seed = prg();
+  link.clear();
+
+  Share<Mode::G>::initialize(key, seed);
+  run_bench_case<Mode::G>(c, naive, warmup);
+  const auto g_bytes = link.size();
+  const auto g_hashes = total_hashes(Mode::G);
+  const auto garble = timed([&] { run_bench_case<Mode::G>(c, naive, reps); });
+
+  Share<Mode::E>::initialize(key, seed);
+  run_bench_case<Mode::E>(c, naive, warmup);
+  const auto e_hashes = total_hashes(Mode::E);
+  const auto evaluate = timed([&] { run_bench_case<Mode::E>(c, naive, reps); });
+  if (link.remaining() != 0) {
+    std::cerr << "ERROR: " << c.name << " left " << link.remaining() << " bytes unread\n";
+    std::exit(1);
+  }
+
+  return {
+    c.name, naive, chunking_factor(), worker_threads(), reps,
+    garble / reps * 1e6,
+    evaluate / reps * 1e6,
+    static_cast<double>(link.size() - g_bytes) / reps,
+    static_cast<double>(total_hashes(Mode::G) - g_hashes) / reps,
+    static_cast<double>(total_hashes(Mode::E) - e_hashes) / reps,
+    false,
+  };
+}
+
+
+void check(TranscriptLink& link, const BenchCase& c, bool naive) {
+  PRG prg;
+  const auto key = prg();
+  const auto seed = prg();
+
+  for (std::size_t t = 0; t < checks_per_measurement; ++t) {
+    std::vector<Matrix> in;
+    for (const auto& [n, m]: c.inputs) {
+      Matrix v(n, m);
+      for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < m; ++j) { v(i, j) = check_rng() & 1; }
+      }
+      in.push_back(v);
+    }
+
+    link.clear();
+    Share<Mode::G>::initialize(key, seed);
+    check_bench_case<Mode::G>(c, naive, in);
+    Share<Mode::E>::initialize(key, seed);
+    const auto got = check_bench_case<Mode::E>(c, naive, in);
+    const auto expected = c.reference(in);
+
+    bool ok = got.rows() == expected.rows() && got.cols() == expected.cols();
+    for (std::size_t i = 0; ok && i < got.rows(); ++i) {
+      for (std::size_t j = 0; j < got.cols(); ++j) { ok = ok && got(i, j) == expected(i, j); }
+    }
+    if (!ok) {
+      std::cerr << "ERROR: " << c.name << " (" << (naive ? "naive" : "one-hot")
+        << ", chunk " << chunking_factor() << ", threads " << worker_threads()
+        << ") disagrees with its reference\n";
+      for (std::size_t k = 0; k < in.size(); ++k) { std::cerr << "input " << k << ":\n" << in[k]; }
+      std::cerr << "expected:\n" << expected << "got:\n" << got;
+      std::exit(1);
+    }
+  }
+}
+
+
+void write_csv(std::ostream& os, const std::vector<Result>& results) {
+  os << "case,version,chunk,threads,reps,garble_us_per_op,evaluate_us_per_op,"
+     << "bytes_per_op,g_aes_per_op,e_aes_per_op,checked\n";
+  for (const auto& r: results) {
+    os << r.name << ',' << (r.naive ? "naive" : "one-hot") << ',';
+    if (!r.naive) { os << r.chunk << ',' << r.threads << ','; } else { os << ",,"; }
+    os << r.reps << ',' << r.garble_us << ',' << r.evaluate_us << ','
+       << r.bytes << ',' << r.g_hashes << ',' << r.e_hashes << ',' << r.checked << '\n';
+  }
+}
+
+
+void write_json(std::ostream& os, const std::vector<Result>& results) {
+  os << "[";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto& r = results[i];
+    os << (i ? ",\n " : "\n ")
+       << "{\"case\": \"" << r.name << "\", \"version\": \"" << (r.naive ? "naive" : "one-hot") << "\"";
+    if (!r.naive) { os << ", \"chunk\": " << r.chunk << ", \"threads\": " << r.threads; }
+    os << ", \"reps\": " << r.reps
+       << ", \"garble_us_per_op\": " << r.garble_us
+       << ", \"evaluate_us_per_op\": " << r.evaluate_us
+       << ", \"bytes_per_op\": " << r.bytes
+       << ", \"g_aes_per_op\": " << r.g_hashes
+       << ", \"e_aes_per_op\": " << r.e_hashes
+       << ", \"checked\": " << (r.checked ? "true" : "false") << "}";
+  }
+  os << "\n]\n";
+}
+
+
+int main(int argc, char** argv) {
+  bool json = false;
+  bool checked = false;
+  std::size_t reps = 0;
+  std::size_t warmup = 0;
+  std::vector<std::size_t> chunks { 4, 6, 8 };
+  std::vector<std::size_t> threads { 1, 2, 4 };
+  std::vector<const BenchCase*> cases;
+
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = i + 1 < argc;
+    if (std::strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (std::strcmp(argv[i], "--check") == 0) {
+      checked = true;
+    } else if (std::strcmp(argv[i], "--reps") == 0 && has_value) {
+      reps = std::stoul(argv[++i]);
+    } else if (std::strcmp(argv[i], "--warmup") == 0 && has_value) {
+      warmup = std::stoul(argv[++i]);
+    } else if (std::strcmp(argv[i], "--chunks") == 0 && has_value) {
+      chunks = parse_list(argv[++i]);
+    } else if (std::strcmp(argv[i], "--threads") == 0 && has_value) {
+      threads = parse_list(argv[++i]);
+    } else if (const auto* c = find_bench_case(argv[i])) {
+      cases.push_back(c);
+    } else {
+      std::cerr << "ERROR: unknown argument " << argv[i] << "\ncases:";
+      for (const auto& c: bench_cases()) { std::cerr << ' ' << c.name; }
+      std::cerr << '\n';
+      std::exit(1);
+    }
+  }
+  if (cases.empty()) {
+    for (const auto& c: bench_cases()) { cases.push_back(&c); }
+  }
+
+  TranscriptLink link;
+  *the_link() = &link;
+
+  const auto saved_chunk = chunking_factor();
+  const auto saved_threads = worker_threads();
+
+  std::vector<Result> results;
+  const auto run = [&](const BenchCase& c, bool naive, std::size_t n, std::size_t w) {
+    results.push_back(measure(link, c, naive, n, w));
+    if (checked) {
+      check(link, c, naive);
+      results.back().checked = true;
+    }
+  };
+
+  for (const auto* c: cases) {
+    const auto n = reps ? reps : c->reps;
+    const auto w = warmup ? warmup : (n + 9) / 10;
+
+    for (const auto t: threads) {
+      worker_threads() = t;
+      initialize_gjobs();
+      initialize_ejobs();
+
+      if (t == threads.front() && c->has_naive) {
+        chunking_factor() = saved_chunk;
+        run(*c, true, n, w);
+      }
+      for (const auto k: chunks) {
+        if (!c->has_one_hot) { break; }
+        chunking_factor() = k;
+        run(*c, false, n, w);
+      }
+
+      finalize_gjobs();
+      finalize_ejobs();
+    }
+  }
+
+  chunking_factor() = saved_chunk;
+  worker_threads() = saved_threads;
+
+  if (json) {
+    write_json(std::cout, results);
+  } else {
+    write_csv(std::cout, results);
+  }
+}
@@ -0,0 +1,113 @@
+#include "integer.h"
+#include "compare.h"
+#include "sbox.h"
+#include "transcript_link.h"
+
+#include <iostream>
+#include <chrono>
+#include <functional>
+
+
+// Measures pure garbling and evaluation throughput. G garbles `reps` copies of
+// each workload into an in-memory transcript, then E evaluates them from it on
+// the same thread, so no sockets or party threads are involved. For each
+// workload this prints the exact ciphertexts and bytes per operation and the
+// time per operation on each side.
+//
+// usage: transcript [<repetitions>]
+
+
+template <typename F>
+auto timed(F f) {
+  auto start = std::chrono::high_resolution_clock::now();
+  f();
+  auto finish = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = finish - start;
+  return elapsed.count();
+}
+
+
+template <Mode mode>
+void mul32(std::size_t reps) {
+  auto x = ShareMatrix<mode>::uniform(32, 1);
+  const auto y = ShareMatrix<mode>::uniform(32, 1);
+  for (std::size_t i = 0; i < reps; ++i) {
+    MatrixView<const Share<mode>> a = x;
+    MatrixView<const Share<mode>> b = y;
+    x = integer_multiply<mode>(a, b);
+  }
+}
+
+
+template <Mode mode>
+void sbox(std::size_t reps) {
+  auto x = ShareMatrix<mode>::uniform(8, 1);
+  for (std::size_t i = 0; i < reps; ++i) {
+    x = lookup<mode>(sm4_sbox_table, x);
+  }
+}
+
+
+template <Mode mode>
+void less_than32(std::size_t reps) {
+  const auto x = ShareMatrix<mode>::uniform(32, 1);
+  auto y = ShareMatrix<mode>::uniform(32, 1);
+  for (std::size_t i = 0; i < reps; ++i) {
+    y[0] = less_than<mode>(x, y);
+  }
+}
+
+
+struct Workload {
+  const char* name;
+  std::function<void(std::size_t)> garble;
+  std::function<void(std::size_t)> evaluate;
+};
+
+
+#define WORKLOAD(f) Workload { #f, f<Mode::G>, f<Mode::E> }
+
+
+int main(int argc, char** argv) {
+  const std::size_t reps = argc > 1 ? atoi(argv[1]) : 1000;
+
+  const std::vector<Workload> workloads {
+    WORKLOAD(mul32),
+    WORKLOAD(sbox),
+    WORKLOAD(less_than32),
+  };
+
+  PRG prg;
+  const auto key = prg();
+  const auto seed = prg();
+
+  TranscriptLink link;
+  *the_link() = &link;
+  initialize_gjobs();
+  initialize_ejobs();
+
+  std::cout << "workload,ciphertexts_per_op,bytes_per_op,garble_us_per_op,evaluate_us_per_op\n";
+  for (const auto& w: workloads) {
+    link.clear();
+
+    Share<Mode::G>::initialize(key, seed);
+    const auto garble = timed([&] { w.garble(reps); });
+    const auto ciphertexts = n_ciphertexts();
+
+    Share<Mode::E>::initialize(key, seed);
+    const auto evaluate = timed([&] { w.evaluate(reps); });
+    if (link.remaining() != 0) {
+      std::cerr << "ERROR: " << w.name << " left " << link.remaining() << " bytes unread\n";
+      std::exit(1);
+    }
+
+    std::cout << w.name << ','
+      << static_cast<double>(ciphertexts) / reps << ','
+      << static_cast<double>(link.size()) / reps << ','
+      << garble / reps * 1e6 << ','
+      << evaluate / reps * 1e6 << '\n';
+  }
+
+  finalize_gjobs();
+  finalize_ejobs();
+}
@@ -0,0 +1,617 @@
+#ifndef BENCH_CASES_H__
+#define BENCH_CASES_H__
+
+
+#include "share_matrix.h"
+#include "integer.h"
+#include "non_blackbox_gf256.h"
+#include "standard_sbox.h"
+#include "standard_mul_gf256.h"
+#include "sbox.h"
+#include "gf2k.h"
+#include "ghash.h"
+#include "modular.h"
+#include "compare.h"
+#include "fixed_point.h"
+#include "division.h"
+
+#include <array>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+
+// The gadgets the benchmark drivers know by name. Each case is one operation
+// of a gadget, built either from AND gates alone (naive) or with one-hot
+// garbling, together with a cleartext reference for the same operation.
+
+
+template <Mode mode>
+using BenchInputs = std::vector<ShareMatrix<mode>>;
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_outer_product(bool naive, const BenchInputs<mode>& in) {
+  if (naive) {
+    return naive_outer_product<mode>(in[0], in[1]);
+  } else {
+    return outer_product<mode>(in[0], in[1]);
+  }
+}
+
+inline Matrix reference_outer_product(const std::vector<Matrix>& in) {
+  return in[0].outer_product(in[1]);
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_matrix_multiply(bool naive, const BenchInputs<mode>& in) {
+  MatrixView<const Share<mode>> x = in[0];
+  MatrixView<const Share<mode>> y = in[1];
+  if (naive) {
+    return naive_matrix_multiplication<mode>(x, y);
+  } else {
+    return x * y;
+  }
+}
+
+inline Matrix reference_matrix_multiply(const std::vector<Matrix>& in) {
+  const auto& x = in[0];
+  const auto& y = in[1];
+  Matrix out(x.rows(), y.cols());
+  for (std::size_t i = 0; i < x.rows(); ++i) {
+    for (std::size_t j = 0; j < y.cols(); ++j) {
+      bool sum = false;
+      for (std::size_t k = 0; k < x.cols(); ++k) { sum ^= x(i, k) & y(k, j); }
+      out(i, j) = sum;
+    }
+  }
+  return out;
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_integer_mul(bool naive, const BenchInputs<mode>& in) {
+  MatrixView<const Share<mode>> x = in[0];
+  MatrixView<const Share<mode>> y = in[1];
+  if (naive) {
+    return naive_integer_multiply<mode>(x, y);
+  } else {
+    return integer_multiply<mode>(x, y);
+  }
+}
+
+inline Matrix reference_integer_mul(const std::vector<Matrix>& in) {
+  return from_uint32(to_uint32(in[0]) * to_uint32(in[1]));
+}
+
+
+constexpr std::uint32_t bench_base = 13;
+
+template <Mode mode>
+ShareMatrix<mode> bench_integer_exp(bool naive, const BenchInputs<mode>& in) {
+  if (naive) {
+    return naive_exponent<mode>(bench_base, in[0]);
+  } else {
+    return exponent<mode>(bench_base, in[0]);
+  }
+}
+
+inline Matrix reference_integer_exp(const std::vector<Matrix>& in) {
+  return from_uint32(pow32(bench_base, to_uint32(in[0])));
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_integer_modp(bool naive, const BenchInputs<mode>& in) {
+  if (naive) {
+    return naive_mod_p<mode>(in[0]);
+  } else {
+    return mod_p<mode>(in[0]);
+  }
+}
+
+inline Matrix reference_integer_modp(const std::vector<Matrix>& in) {
+  return from_uint32(to_uint32(in[0]) % p);
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_mul_gf256(bool naive, const BenchInputs<mode>& in) {
+  if (naive) {
+    return standard_mul_gf256<mode>(in[0], in[1]);
+  } else {
+    return mul_gf256<mode>(in[0], in[1]);
+  }
+}
+
+inline Matrix reference_mul_gf256(const std::vector<Matrix>& in) {
+  return byte_to_vector(mul_gf256(vector_to_byte(in[0]), vector_to_byte(in[1])));
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_aes_sbox(bool naive, const BenchInputs<mode>& in) {
+  if (naive) {
+    return standard_aes_sbox<mode>(in[0]);
+  } else {
+    return aes_sbox<mode>(in[0]);
+  }
+}
+
+inline Matrix reference_aes_sbox(const std::vector<Matrix>& in) {
+  const std::uint8_t b = invert_gf256(vector_to_byte(in[0]));
+  const auto rotl = [b](int k) { return static_cast<std::uint8_t>((b << k) | (b >> (8 - k))); };
+  return byte_to_vector(b ^ rotl(1) ^ rotl(2) ^ rotl(3) ^ rotl(4) ^ 0x63);
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_present_sbox(bool, const BenchInputs<mode>& in) {
+  return lookup<mode>(present_sbox_table, in[0]);
+}
+
+inline Matrix reference_present_sbox(const std::vector<Matrix>& in) {
+  return from_limbs({ present_sbox_table(to_limbs(in[0])[0]) }, 4);
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_sm4_sbox(bool, const BenchInputs<mode>& in) {
+  return lookup<mode>(sm4_sbox_table, in[0]);
+}
+
+inline Matrix reference_sm4_sbox(const std::vector<Matrix>& in) {
+  return byte_to_vector(sm4_sbox_table(vector_to_byte(in[0])));
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_gf65536_mul(bool, const BenchInputs<mode>& in) {
+  return mul<GF65536, mode>(in[0], in[1]);
+}
+
+inline Matrix reference_gf65536_mul(const std::vector<Matrix>& in) {
+  return GF65536::to_vector(GF65536::mul(GF65536::from_vector(in[0]), GF65536::from_vector(in[1])));
+}
+
+
+// One-hot inversion over all 2^16 elements.
+template <Mode mode>
+ShareMatrix<mode> bench_gf65536_invert(bool, const BenchInputs<mode>& in) {
+  return invert<GF65536, mode>(in[0]);
+}
+
+inline Matrix reference_gf65536_invert(const std::vector<Matrix>& in) {
+  return GF65536::to_vector(GF65536::invert(GF65536::from_vector(in[0])));
+}
+
+
+// Inversion by an addition chain of one-hot multiplications.
+template <Mode mode>
+ShareMatrix<mode> bench_gf2_32_invert(bool, const BenchInputs<mode>& in) {
+  return invert<GF2_32, mode>(in[0]);
+}
+
+inline Matrix reference_gf2_32_invert(const std::vector<Matrix>& in) {
+  return GF2_32::to_vector(GF2_32::invert(GF2_32::from_vector(in[0])));
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_mul_gf128(bool, const BenchInputs<mode>& in) {
+  return mul_gf128<mode>(in[0], in[1]);
+}
+
+inline Matrix reference_mul_gf128(const std::vector<Matrix>& in) {
+  return mul_gf128(in[0], in[1]);
+}
+
+
+// GHASH of four blocks; the first input is the hash key.
+template <Mode mode>
+ShareMatrix<mode> bench_ghash(bool, const BenchInputs<mode>& in) {
+  return ghash<mode>(in[0], { in.begin() + 1, in.end() });
+}
+
+inline Matrix reference_ghash(const std::vector<Matrix>& in) {
+  auto y = Matrix::vector(128);
+  for (std::size_t i = 1; i < in.size(); ++i) { y = mul_gf128(y ^ in[i], in[0]); }
+  return y;
+}
+
+
+// The full 2n-bit product of n-bit integers, by Karatsuba and by the one-hot
+// schoolbook product it replaces. Both take inputs of any width; the suite
+// compares them at 64 and 256 bits and runs Karatsuba alone at 2048, where
+// the schoolbook product takes seconds per operation.
+template <Mode mode>
+ShareMatrix<mode> bench_schoolbook_mul(bool, const BenchInputs<mode>& in) {
+  MatrixView<const Share<mode>> x = in[0];
+  MatrixView<const Share<mode>> y = in[1];
+  return integer_multiply_wide<mode>(x, y);
+}
+
+template <Mode mode>
+ShareMatrix<mode> bench_karatsuba_mul(bool, const BenchInputs<mode>& in) {
+  return karatsuba_multiply<mode>(in[0], in[1]);
+}
+
+inline Matrix reference_wide_mul(const std::vector<Matrix>& in) {
+  const auto x = to_limbs(in[0]);
+  const auto y = to_limbs(in[1]);
+  std::vector<std::uint64_t> out(x.size() + y.size());
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    unsigned __int128 carry = 0;
+    for (std::size_t j = 0; j < y.size(); ++j) {
+      carry += static_cast<unsigned __int128>(x[i]) * y[j] + out[i + j];
+      out[i + j] = static_cast<std::uint64_t>(carry);
+      carry >>= 64;
+    }
+    out[i + y.size()] = static_cast<std::uint64_t>(carry);
+  }
+  return from_limbs(out, in[0].rows() + in[1].rows());
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_tree_exp(bool, const BenchInputs<mode>& in) {
+  return tree_exponent<mode>(bench_base, in[0]);
+}
+
+inline Matrix reference_tree_exp(const std::vector<Matrix>& in) {
+  return from_uint32(pow32(bench_base, to_uint32(in[0])));
+}
+
+
+// mod_reduce takes any 64-bit input and mod_mul any pair of inputs of the
+// modulus's width, so their inputs are uniform. mod_inverse needs x in [1, p)
+// and mod_exp a base in [0, p): their bases have 15 bits, below p = 65521,
+// and the inverse's is odd.
+constexpr std::uint64_t bench_modulus = 2147483647;  // 2^31 - 1
+
+template <Mode mode>
+ShareMatrix<mode> bench_mod_reduce(bool, const BenchInputs<mode>& in) {
+  static const ModularReduction plan { bench_modulus, 64 };
+  return mod_reduce<mode>(plan, in[0]);
+}
+
+inline Matrix reference_mod_reduce(const std::vector<Matrix>& in) {
+  return from_limbs({ to_uint64(in[0]) % bench_modulus }, 31);
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_mod_mul(bool, const BenchInputs<mode>& in) {
+  return mod_mul<mode>(bench_modulus, in[0], in[1]);
+}
+
+inline Matrix reference_mod_mul(const std::vector<Matrix>& in) {
+  return from_limbs({ to_limbs(in[0])[0] * to_limbs(in[1])[0] % bench_modulus }, 31);
+}
+
+
+inline std::uint64_t pow_mod(std::uint64_t x, std::uint64_t e, std::uint64_t m) {
+  std::uint64_t out = 1 % m;
+  for (x %= m; e > 0; e >>= 1) {
+    if (e & 1) { out = out * x % m; }
+    x = x * x % m;
+  }
+  return out;
+}
+
+
+// One-hot inversion modulo the 16-bit p of integer_modp.
+template <Mode mode>
+ShareMatrix<mode> bench_mod_inverse(bool, const BenchInputs<mode>& in) {
+  auto x = integer_slice<mode>(in[0], 0, 15, 16);
+  x[0] = Share<mode>::bit(true);
+  return mod_inverse<mode>(p, x);
+}
+
+inline Matrix reference_mod_inverse(const std::vector<Matrix>& in) {
+  return from_limbs({ pow_mod(to_limbs(in[0])[0] | 1, p - 2, p) }, 16);
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_mod_exp(bool, const BenchInputs<mode>& in) {
+  return mod_exp<mode>(p, integer_slice<mode>(in[0], 0, 15, 16), in[1]);
+}
+
+inline Matrix reference_mod_exp(const std::vector<Matrix>& in) {
+  return from_limbs({ pow_mod(to_limbs(in[0])[0], to_limbs(in[1])[0], p) }, 16);
+}
+
+
+// The comparators are built from AND gates alone, so they only have a naive
+// version.
+template <Mode mode>
+ShareMatrix<mode> bench_less_than(bool, const BenchInputs<mode>& in) {
+  auto out = ShareMatrix<mode>::vector(2);
+  out[0] = less_than<mode>(in[0], in[1]);
+  out[1] = less_than<mode>(in[0], in[1], true);
+  return out;
+}
+
+inline Matrix reference_less_than(const std::vector<Matrix>& in) {
+  const auto x = to_uint32(in[0]);
+  const auto y = to_uint32(in[1]);
+  auto out = Matrix::vector(2);
+  out[0] = x < y;
+  out[1] = static_cast<std::int32_t>(x) < static_cast<std::int32_t>(y);
+  return out;
+}
+
+
+// Uniform operands are almost never equal, so the second operand is the first
+// with its low two bits replaced by the second input.
+template <Mode mode>
+ShareMatrix<mode> bench_equal(bool, const BenchInputs<mode>& in) {
+  auto y = in[0];
+  y[0] = in[1][0];
+  y[1] = in[1][1];
+  auto out = ShareMatrix<mode>::vector(1);
+  out[0] = equal<mode>(in[0], y);
+  return out;
+}
+
+inline Matrix reference_equal(const std::vector<Matrix>& in) {
+  auto out = Matrix::vector(1);
+  out[0] = in[0][0] == in[1][0] && in[0][1] == in[1][1];
+  return out;
+}
+
+
+// The quotient followed by the remainder, by long division (naive) or by
+// Newton iteration (one-hot). The divisor is odd, so never zero.
+template <Mode mode>
+ShareMatrix<mode> bench_divide(bool naive, const BenchInputs<mode>& in) {
+  auto d = in[1];
+  d[0] = Share<mode>::bit(true);
+  const auto [q, r] = naive ? divide<mode>(in[0], d) : newton_divide<mode>(in[0], d);
+  auto out = ShareMatrix<mode>::vector(64);
+  for (std::size_t i = 0; i < 32; ++i) {
+    out[i] = q[i];
+    out[32 + i] = r[i];
+  }
+  return out;
+}
+
+inline Matrix reference_divide(const std::vector<Matrix>& in) {
+  const auto a = to_uint32(in[0]);
+  const auto d = to_uint32(in[1]) | 1;
+  return from_uint64((std::uint64_t { a % d } << 32) | (a / d));
+}
+
+
+// Signed division of two's complement operands, with the quotient followed by
+// the remainder. The divisor is odd, so never zero.
+template <Mode mode>
+ShareMatrix<mode> bench_divide_signed(bool, const BenchInputs<mode>& in) {
+  auto d = in[1];
+  d[0] = Share<mode>::bit(true);
+  const auto [q, r] = divide_signed<mode>(in[0], d);
+  auto out = ShareMatrix<mode>::vector(64);
+  for (std::size_t i = 0; i < 32; ++i) {
+    out[i] = q[i];
+    out[32 + i] = r[i];
+  }
+  return out;
+}
+
+inline Matrix reference_divide_signed(const std::vector<Matrix>& in) {
+  // In 64 bits, so that -2^31 / -1 wraps rather than overflows.
+  const std::int64_t a = static_cast<std::int32_t>(to_uint32(in[0]));
+  const std::int64_t d = static_cast<std::int32_t>(to_uint32(in[1]) | 1);
+  const auto q = static_cast<std::uint32_t>(a / d);
+  const auto r = static_cast<std::uint32_t>(a % d);
+  return from_uint64((std::uint64_t { r } << 32) | q);
+}
+
+// Fixed16 exp on [4, 5), across the point (ln 128) where it leaves the range:
+// the input is the fraction, so every operation lands in that region. There
+// is no version without one-hot garbling.
+template <Mode mode>
+ShareMatrix<mode> bench_fixed16_exp_top(bool, const BenchInputs<mode>& in) {
+  auto x = Fixed16<mode>::constant(4);
+  for (std::size_t i = 0; i < Fixed16<mode>::fraction; ++i) { x.value[i] = in[0][i]; }
+  return exp(x).matrix();
+}
+
+inline Matrix reference_fixed16_exp_top(const std::vector<Matrix>& in) {
+  using F = Fixed16<Mode::G>;
+  const auto x = F::encode(4) + static_cast<std::int64_t>(vector_to_byte(in[0]));
+  return from_limbs({ static_cast<std::uint64_t>(exp<F::width, F::fraction>(x)) }, F::width);
+}
+
+
+// The activations take 13-bit inputs sign-extended to Fixed16, so that about
+// half of them fall inside the tables' ranges and the rest saturate.
+template <Mode mode>
+Fixed16<mode> bench_fixed16(const ShareMatrix<mode>& in) {
+  Fixed16<mode> x;
+  for (std::size_t i = 0; i < 16; ++i) { x.value[i] = in[std::min<std::size_t>(i, in.rows() - 1)]; }
+  return x;
+}
+
+inline std::int64_t reference_fixed16(const Matrix& in) {
+  const auto n = in.rows();
+  const auto v = static_cast<std::int64_t>(to_limbs(in)[0]);
+  return v - (static_cast<std::int64_t>(in[n-1]) << n);
+}
+
+inline Matrix reference_fixed16_matrix(std::int64_t x) {
+  return from_limbs({ static_cast<std::uint64_t>(x) }, 16);
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_fixed16_relu(bool, const BenchInputs<mode>& in) {
+  return relu(bench_fixed16<mode>(in[0])).matrix();
+}
+
+inline Matrix reference_fixed16_relu(const std::vector<Matrix>& in) {
+  return reference_fixed16_matrix(relu<16, 8>(reference_fixed16(in[0])));
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_fixed16_sigmoid(bool, const BenchInputs<mode>& in) {
+  return sigmoid(bench_fixed16<mode>(in[0])).matrix();
+}
+
+inline Matrix reference_fixed16_sigmoid(const std::vector<Matrix>& in) {
+  return reference_fixed16_matrix(sigmoid<16, 8>(reference_fixed16(in[0])));
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_fixed16_tanh(bool, const BenchInputs<mode>& in) {
+  return tanh(bench_fixed16<mode>(in[0])).matrix();
+}
+
+inline Matrix reference_fixed16_tanh(const std::vector<Matrix>& in) {
+  return reference_fixed16_matrix(tanh<16, 8>(reference_fixed16(in[0])));
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> bench_fixed16_exp(bool, const BenchInputs<mode>& in) {
+  return exp(bench_fixed16<mode>(in[0])).matrix();
+}
+
+inline Matrix reference_fixed16_exp(const std::vector<Matrix>& in) {
+  return reference_fixed16_matrix(exp<16, 8>(reference_fixed16(in[0])));
+}
+
+
+// rsqrt takes positive inputs: 31 uniform bits below a clear sign bit.
+template <Mode mode>
+ShareMatrix<mode> bench_fixed32_rsqrt(bool, const BenchInputs<mode>& in) {
+  Fixed32<mode> x;
+  for (std::size_t i = 0; i < 31; ++i) { x.value[i] = in[0][i]; }
+  x.value[31] = Share<mode>::bit(false);
+  return rsqrt(x).matrix();
+}
+
+inline Matrix reference_fixed32_rsqrt(const std::vector<Matrix>& in) {
+  const auto x = static_cast<std::int64_t>(to_limbs(in[0])[0]);
+  return from_limbs({ static_cast<std::uint64_t>(rsqrt<32, 16>(x)) }, 32);
+}
+
+
+struct BenchCase {
+  const char* name;
+  // Operations per measurement unless the driver is told otherwise.
+  std::size_t reps;
+  // The shape of each input.
+  std::vector<std::array<std::size_t, 2>> inputs;
+  std::function<ShareMatrix<Mode::G>(bool, const BenchInputs<Mode::G>&)> garble;
+  std::function<ShareMatrix<Mode::E>(bool, const BenchInputs<Mode::E>&)> evaluate;
+  std::function<Matrix(const std::vector<Matrix>&)> reference;
+  // Whether the case has a version built from AND gates alone, and one with
+  // one-hot garbling.
+  bool has_naive = true;
+  bool has_one_hot = true;
+
+  template <Mode mode>
+  ShareMatrix<mode> operator()(bool naive, const BenchInputs<mode>& in) const {
+    if constexpr (mode == Mode::G) {
+      return garble(naive, in);
+    } else {
+      return evaluate(naive, in);
+    }
+  }
+};
+
+
+#define BENCH_CASE(name, reps, ...) \
+  BenchCase { #name, reps, { __VA_ARGS__ }, bench_##name<Mode::G>, bench_##name<Mode::E>, reference_##name }
+
+#define ONE_HOT_CASE(name, reps, ...) \
+  BenchCase { #name, reps, { __VA_ARGS__ }, bench_##name<Mode::G>, bench_##name<Mode::E>, reference_##name, false, true }
+
+#define NAIVE_CASE(name, reps, ...) \
+  BenchCase { #name, reps, { __VA_ARGS__ }, bench_##name<Mode::G>, bench_##name<Mode::E>, reference_##name, true, false }
+
+// An n x n -> 2n bit product, named with its width.
+#define WIDE_MUL_CASE(name, n, reps) \
+  BenchCase { #name #n, reps, { { n, 1 }, { n, 1 } }, bench_##name<Mode::G>, bench_##name<Mode::E>, reference_wide_mul, false, true }
+
+
+inline const std::vector<BenchCase>& bench_cases() {
+  static const std::vector<BenchCase> cases {
+    BENCH_CASE(outer_product, 100, { 64, 1 }, { 64, 1 }),
+    BENCH_CASE(matrix_multiply, 1, { 64, 64 }, { 64, 64 }),
+    BENCH_CASE(integer_mul, 1000, { 32, 1 }, { 32, 1 }),
+    BENCH_CASE(integer_exp, 100, { 32, 1 }),
+    BENCH_CASE(integer_modp, 1000, { 32, 1 }),
+    BENCH_CASE(mul_gf256, 1000, { 8, 1 }, { 8, 1 }),
+    BENCH_CASE(aes_sbox, 1000, { 8, 1 }),
+    ONE_HOT_CASE(present_sbox, 1000, { 4, 1 }),
+    ONE_HOT_CASE(sm4_sbox, 1000, { 8, 1 }),
+    ONE_HOT_CASE(gf65536_mul, 1000, { 16, 1 }, { 16, 1 }),
+    ONE_HOT_CASE(gf65536_invert, 10, { 16, 1 }),
+    ONE_HOT_CASE(gf2_32_invert, 10, { 32, 1 }),
+    ONE_HOT_CASE(mul_gf128, 10, { 128, 1 }, { 128, 1 }),
+    ONE_HOT_CASE(ghash, 10, { 128, 1 }, { 128, 1 }, { 128, 1 }, { 128, 1 }, { 128, 1 }),
+    WIDE_MUL_CASE(schoolbook_mul, 64, 100),
+    WIDE_MUL_CASE(karatsuba_mul, 64, 100),
+    WIDE_MUL_CASE(schoolbook_mul, 256, 10),
+    WIDE_MUL_CASE(karatsuba_mul, 256, 10),
+    WIDE_MUL_CASE(karatsuba_mul, 2048, 1),
+    ONE_HOT_CASE(tree_exp, 100, { 32, 1 }),
+    ONE_HOT_CASE(mod_reduce, 100, { 64, 1 }),
+    ONE_HOT_CASE(mod_mul, 100, { 31, 1 }, { 31, 1 }),
+    ONE_HOT_CASE(mod_inverse, 10, { 15, 1 }),
+    ONE_HOT_CASE(mod_exp, 10, { 15, 1 }, { 16, 1 }),
+    NAIVE_CASE(less_than, 1000, { 32, 1 }, { 32, 1 }),
+    NAIVE_CASE(equal, 1000, { 32, 1 }, { 2, 1 }),
+    BENCH_CASE(divide, 100, { 32, 1 }, { 32, 1 }),
+    NAIVE_CASE(divide_signed, 100, { 32, 1 }, { 32, 1 }),
+    NAIVE_CASE(fixed16_relu, 1000, { 16, 1 }),
+    ONE_HOT_CASE(fixed16_sigmoid, 100, { 13, 1 }),
+    ONE_HOT_CASE(fixed16_tanh, 100, { 13, 1 }),
+    ONE_HOT_CASE(fixed16_exp, 100, { 13, 1 }),
+    ONE_HOT_CASE(fixed16_exp_top, 100, { 8, 1 }),
+    ONE_HOT_CASE(fixed32_rsqrt, 10, { 31, 1 }),
+  };
+  return cases;
+}
+
+
+inline const BenchCase* find_bench_case(std::string_view name) {
+  for (const auto& c: bench_cases()) {
+    if (name == c.name) { return &c; }
+  }
+  return nullptr;
+}
+
+
+// Runs `reps` operations of a case on uniform inputs.
+template <Mode mode>
+void run_bench_case(const BenchCase& c, bool naive, std::size_t reps) {
+  BenchInputs<mode> in;
+  for (const auto& [n, m]: c.inputs) { in.push_back(ShareMatrix<mode>::uniform(n, m)); }
+  for (std::size_t i = 0; i < reps; ++i) {
+    c.operator()<mode>(naive, in);
+  }
+}
+
+
+// Runs one operation of a case on G's cleartext inputs (E passes matrices of
+// the same shapes, whose contents it ignores) and opens the output to E. G
+// returns an empty matrix.
+template <Mode mode>
+Matrix check_bench_case(const BenchCase& c, bool naive, const std::vector<Matrix>& values) {
+  BenchInputs<mode> in;
+  for (const auto& v: values) {
+    const auto u = ShareMatrix<mode>::uniform(v.rows(), v.cols());
+    in.push_back(ShareMatrix<mode>::constant(v) ^ u ^ ShareMatrix<mode>::constant(color<mode>(u)));
+  }
+  return c.operator()<mode>(naive, in).decode_to_evaluator(true);
+}
+
+
+#endif
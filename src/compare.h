@@ -0,0 +1,93 @@
+#ifndef COMPARE_H__
+#define COMPARE_H__
+
+
+#include "integer.h"
+
+#include <utility>
+
+
+// Comparators built from AND gates alone: x < y is the borrow out of x - y,
+// n AND gates in a ripple, and x == y is an AND tree over the bits of x + y + 1,
+// n - 1 AND gates of depth log(n). A one-hot lookup on a chunk of c bits of
+// each input costs more: it is a lookup on 2c bits that produces only one or
+// two bits of output (316 to 2188 ciphertexts for a 32-bit x < y, against 64).
+
+
+// The borrow out of the top bit of x - y, that is, x < y for unsigned x and y.
+template <Mode mode>
+Share<mode> borrow_out(const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
+  const auto n = x.rows();
+  assert(y.rows() == n);
+
+  Phase phase { "and gates" };
+  auto borrow = Share<mode>::bit(false);
+  for (std::size_t i = 0; i < n; ++i) { subtract_bit<mode>(x[i], y[i], borrow); }
+  return borrow;
+}
+
+
+template <Mode mode>
+Share<mode> equal(const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
+  const auto n = x.rows();
+  assert(y.rows() == n);
+
+  std::vector<Share<mode>> eq(n);
+  for (std::size_t i = 0; i < n; ++i) { eq[i] = ~(x[i] ^ y[i]); }
+  return and_tree<mode>(std::move(eq));
+}
+
+
+// Computes (x < y, x == y) for unsigned x and y.
+template <Mode mode>
+std::pair<Share<mode>, Share<mode>> compare(
+    const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
+  return { borrow_out<mode>(x, y), equal<mode>(x, y) };
+}
+
+
+// Flipping the sign bits maps two's complement order onto unsigned order.
+template <Mode mode>
+ShareMatrix<mode> flip_sign(ShareMatrix<mode> x) {
+  const auto n = x.rows();
+  x[n-1] = ~x[n-1];
+  return x;
+}
+
+
+template <Mode mode>
+Share<mode> less_than(
+    const ShareMatrix<mode>& x, const ShareMatrix<mode>& y, bool is_signed = false) {
+  if (is_signed) {
+    return borrow_out<mode>(flip_sign<mode>(x), flip_sign<mode>(y));
+  }
+  return borrow_out<mode>(x, y);
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> min(
+    const ShareMatrix<mode>& x, const ShareMatrix<mode>& y, bool is_signed = false) {
+  return swap<mode>(less_than<mode>(x, y, is_signed), x, y);
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> max(
+    const ShareMatrix<mode>& x, const ShareMatrix<mode>& y, bool is_signed = false) {
+  return swap<mode>(less_than<mode>(x, y, is_signed), y, x);
+}
+
+
+// Clamps x into [lo, hi]; lo must not exceed hi.
+template <Mode mode>
+ShareMatrix<mode> clamp(
+    const ShareMatrix<mode>& x,
+    const ShareMatrix<mode>& lo,
+    const ShareMatrix<mode>& hi,
+    bool is_signed = false) {
+  return min<mode>(max<mode>(x, lo, is_signed), hi, is_signed);
+}
+
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef DIVISION_H__
+#define DIVISION_H__
+
+
+#include "integer.h"
+#include "unary_outer_product.h"
+
+#include <bit>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+
+// Division by a secret divisor. `divide` is restoring long division from AND
+// gates, about n^2 of them. `newton_divide` normalizes d to d' = d 2^z with
+// its top bit set, seeds an approximation of 2^2n / d' by a one-hot lookup on
+// the top bits of d', refines it by Newton steps and multiplies it by the
+// dividend. Its approximation never overshoots and is at most one short, so a
+// single correction step finishes the job. The Newton steps and the final
+// products take about six multiplications of n + 1 bits: for n = 32, about 17k
+// ciphertexts against 2.2k for long division, so the wrappers below use
+// `divide`.
+
+
+// The leading zero count is found by lookups over chunks of this many bits.
+constexpr std::size_t leading_zero_chunk = 4;
+
+// The reciprocal seed is looked up on this many top bits of d'. The top bit
+// is always set, so the table has 2^(reciprocal_seed_bits - 1) rows.
+constexpr std::size_t reciprocal_seed_bits = 8;
+
+
+// Row v is the number of leading zeros of an n-bit integer whose highest set
+// bit lies in the chunk of bits [offset, offset + size) with value v. Bit
+// bit_width(n) of the row is set when v is non-zero.
+struct LeadingZeroTable : public Table {
+  LeadingZeroTable(std::size_t n, std::size_t offset) : n(n), offset(offset) { }
+
+  std::size_t operator()(std::size_t v) const {
+    if (v == 0) { return 0; }
+    return (n - offset - std::bit_width(v)) | (std::size_t { 1 } << std::bit_width(n));
+  }
+
+  std::size_t n;
+  std::size_t offset;
+};
+
+
+// Row i approximates 2^2c / (t + 1/2), where t = 2^(c-1) + i is the value of
+// the top c bits of a normalized divisor.
+struct ReciprocalTable : public Table {
+  ReciprocalTable(std::size_t c) : c(c) { }
+
+  std::size_t operator()(std::size_t i) const {
+    const auto t = (std::size_t { 1 } << (c - 1)) + i;
+    return std::llround(std::ldexp(1, 2*c) / (t + 0.5));
+  }
+
+  std::size_t c;
+};
+
+
+// Counts the leading zeros of a non-zero x. Every chunk looks up the count
+// that holds if it contains the highest set bit, and the highest non-zero
+// chunk wins.
+template <Mode mode>
+ShareMatrix<mode> leading_zeros(const ShareMatrix<mode>& x) {
+  const auto n = x.rows();
+  const std::size_t l = std::bit_width(n);
+  const auto n_chunks = (n + leading_zero_chunk - 1) / leading_zero_chunk;
+
+  // Chunk 0 is the most significant; the lowest chunk is the default.
+  ShareMatrix<mode> out;
+  for (std::size_t j = n_chunks; j-- > 0;) {
+    const auto top = n - j*leading_zero_chunk;
+    const auto size = std::min(leading_zero_chunk, top);
+    const auto offset = top - size;
+
+    LeadingZeroTable table { n, offset };
+    const auto row = lookup<mode>(table, l + 1, integer_slice<mode>(x, offset, size, size));
+    const auto count = integer_slice<mode>(row, 0, l, l);
+    out = j + 1 == n_chunks ? count : swap<mode>(row[l], count, out);
+  }
+  return out;
+}
+
+
+// Shifts x left by a secret amount, one multiplexer per bit of the amount.
+template <Mode mode>
+ShareMatrix<mode> shift_left(ShareMatrix<mode> x, const ShareMatrix<mode>& amount) {
+  const auto n = x.rows();
+  for (std::size_t k = 0; k < amount.rows() && (std::size_t { 1 } << k) < n; ++k) {
+    const auto by = std::size_t { 1 } << k;
+    auto shifted = ShareMatrix<mode>::vector(n);
+    for (std::size_t i = by; i < n; ++i) { shifted[i] = x[i - by]; }
+    x = swap<mode>(amount[k], shifted, x);
+  }
+  return x;
+}
+
+
+// Computes (a / d, a mod d) for unsigned a and non-zero d of the same width by
+// Newton iteration on the reciprocal of d.
+template <Mode mode>
+std::pair<ShareMatrix<mode>, ShareMatrix<mode>> newton_divide(
+    const ShareMatrix<mode>& a, const ShareMatrix<mode>& d) {
+  const auto n = a.rows();
+  assert(d.rows() == n);
+  assert(n >= 2);
+
+  const auto z = leading_zeros<mode>(d);
+  const auto dn = shift_left<mode>(d, z);
+
+  // seed: y ~ 2^2n / d', which fits in n + 1 bits
+  const auto c = std::min(reciprocal_seed_bits, n);
+  ReciprocalTable table { c };
+  const auto seed = lookup<mode>(table, c + 1, integer_slice<mode>(dn, n - c, c - 1, c - 1));
+  auto y = ShareMatrix<mode>::vector(n + 1);
+  for (std::size_t i = 0; i < c + 1; ++i) { y[n - c + i] = seed[i]; }
+
+  // Each step y <- y (2^(2n+1) - d' y) / 2^2n doubles the number of correct
+  // bits. The second factor is truncated to its top n + 1 bits first.
+  const auto steps = c >= n ? 0 : std::bit_width((n - 1) / c);
+  auto two = ShareMatrix<mode>::vector(2*n + 2);
+  two[2*n + 1] = Share<mode>::bit(true);
+  for (std::size_t i = 0; i < steps; ++i) {
+    const auto p = karatsuba_multiply<mode>(integer_slice<mode>(dn, 0, n, n + 1), y);
+    const auto m = integer_sub<mode>(two, p);
+    y = integer_slice<mode>(
+        karatsuba_multiply<mode>(y, integer_slice<mode>(m, n, n + 1, n + 1)), n, n + 1, n + 1);
+  }
+
+  // q = ((a y / 2^n) 2^z) / 2^n
+  const auto ay = karatsuba_multiply<mode>(integer_slice<mode>(a, 0, n, n + 1), y);
+  const auto scaled = shift_left<mode>(integer_slice<mode>(ay, n, n + 2, 2*n + 2), z);
+  auto q = integer_slice<mode>(scaled, n, n, n);
+
+  // q is exact or one short, so r = a - q d lies in [0, 2d).
+  const auto qd = integer_multiply<mode>(q, d, n + 2);
+  const auto r = integer_sub<mode>(integer_slice<mode>(a, 0, n, n + 2), qd);
+  const auto diff = integer_sub<mode>(r, integer_slice<mode>(d, 0, n, n + 2));
+  const auto ge = ~diff[n + 1];
+
+  auto inc = ShareMatrix<mode>::vector(n);
+  inc[0] = ge;
+  q = integer_add<mode>(q, inc);
+  const auto rem = swap<mode>(ge, diff, r);
+  return { q, integer_slice<mode>(rem, 0, n, n) };
+}
+
+
+// Computes (a / d, a mod d) for unsigned a and non-zero d of the same width by
+// restoring long division. Before quotient bit i is found, the remainder has at most n - i - 1 bits, so
+// each step subtracts and selects on n - i bits only; d exceeds the shifted
+// remainder outright when it has a set bit above them. About n^2 AND gates.
+template <Mode mode>
+std::pair<ShareMatrix<mode>, ShareMatrix<mode>> divide(
+    const ShareMatrix<mode>& a, const ShareMatrix<mode>& d) {
+  const auto n = a.rows();
+  assert(d.rows() == n);
+
+  // above[m] is set when d has a set bit at or above bit m.
+  std::vector<Share<mode>> above(n);
+  above[n-1] = d[n-1];
+  for (std::size_t m = n - 1; m-- > 1;) { above[m] = above[m + 1] | d[m]; }
+
+  auto q = ShareMatrix<mode>::vector(n);
+  auto r = ShareMatrix<mode>::vector(0);
+  for (std::size_t i = n; i-- > 0;) {
+    const auto m = n - i;
+    auto t = ShareMatrix<mode>::vector(m + 1);
+    t[0] = a[i];
+    for (std::size_t k = 1; k < m; ++k) { t[k] = r[k - 1]; }
+
+    const auto diff = integer_sub<mode>(t, integer_slice<mode>(d, 0, m, m + 1));
+    q[i] = m == n ? ~diff[m] : ~diff[m] & ~above[m];
+    r = swap<mode>(q[i], integer_slice<mode>(diff, 0, m, m), integer_slice<mode>(t, 0, m, m));
+  }
+  return { q, r };
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> negate(const ShareMatrix<mode>& x) {
+  return integer_sub<mode>(ShareMatrix<mode>::vector(x.rows()), x);
+}
+
+
+// if s, -x, else x
+template <Mode mode>
+ShareMatrix<mode> conditional_negate(const Share<mode>& s, const ShareMatrix<mode>& x) {
+  return swap<mode>(s, negate<mode>(x), x);
+}
+
+
+// Computes (a / d, a mod d) for two's complement a and non-zero d, rounding
+// the quotient toward zero; the remainder takes the sign of a.
+template <Mode mode>
+std::pair<ShareMatrix<mode>, ShareMatrix<mode>> divide_signed(
+    const ShareMatrix<mode>& a, const ShareMatrix<mode>& d) {
+  const auto n = a.rows();
+  const auto sa = a[n-1];
+  const auto sd = d[n-1];
+
+  const auto [q, r] = divide<mode>(conditional_negate<mode>(sa, a), conditional_negate<mode>(sd, d));
+  return { conditional_negate<mode>(sa ^ sd, q), conditional_negate<mode>(sa, r) };
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> quotient(const ShareMatrix<mode>& a, const ShareMatrix<mode>& d) {
+  return divide<mode>(a, d).first;
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> remainder(const ShareMatrix<mode>& a, const ShareMatrix<mode>& d) {
+  return divide<mode>(a, d).second;
+}
+
+
+#endif
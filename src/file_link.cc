@@ -0,0 +1,135 @@
+#include "file_link.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+// Writes go out in blocks of this many bytes.
+constexpr std::size_t file_block = 1 << 22;
+
+constexpr std::size_t header_size = 16;
+
+
+[[noreturn]] void file_failure(const char* what, const char* path) {
+  std::cerr << "ERROR: " << what << " " << path << ": " << std::strerror(errno) << '\n';
+  std::exit(1);
+}
+
+
+void write_all(int fd, const std::byte* p, std::size_t n) {
+  while (n > 0) {
+    const auto k = ::write(fd, p, n);
+    if (k < 0) { file_failure("write", "garbled file"); }
+    p += k;
+    n -= k;
+  }
+}
+
+
+FileLink::FileLink(const char* path) {
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) { file_failure("open", path); }
+  buffer.reserve(file_block);
+  // The header is rewritten with the real length by flush.
+  buffer.resize(header_size);
+}
+
+
+FileLink::~FileLink() {
+  flush();
+  close(fd);
+}
+
+
+void FileLink::send(std::span<const std::byte> s) {
+  if (buffer.size() + s.size() > file_block) {
+    write_all(fd, buffer.data(), buffer.size());
+    written += buffer.size();
+    buffer.clear();
+  }
+  if (s.size() >= file_block) {
+    write_all(fd, s.data(), s.size());
+    written += s.size();
+  } else {
+    buffer.insert(buffer.end(), s.begin(), s.end());
+  }
+}
+
+
+void FileLink::recv(std::span<std::byte>) {
+  std::cerr << "ERROR: G cannot receive while garbling offline\n";
+  std::exit(1);
+}
+
+
+void FileLink::flush() {
+  write_all(fd, buffer.data(), buffer.size());
+  written += buffer.size();
+  buffer.clear();
+
+  const std::uint64_t header[2] = { garbled_file_magic, written - header_size };
+  if (pwrite(fd, header, header_size, 0) != header_size) { file_failure("write", "garbled file"); }
+}
+
+
+MmapLink::MmapLink(const char* path) {
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) { file_failure("open", path); }
+  struct stat st;
+  if (fstat(fd, &st) != 0) { file_failure("stat", path); }
+  mapped = st.st_size;
+  if (mapped < header_size) {
+    std::cerr << "ERROR: " << path << " is not a garbled file\n";
+    std::exit(1);
+  }
+
+  void* p = mmap(nullptr, mapped, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) { file_failure("mmap", path); }
+  madvise(p, mapped, MADV_SEQUENTIAL);
+  madvise(p, mapped, MADV_WILLNEED);
+  data = static_cast<const std::byte*>(p);
+
+  std::uint64_t header[2];
+  std::memcpy(header, data, header_size);
+  if (header[0] != garbled_file_magic || header[1] != mapped - header_size) {
+    std::cerr << "ERROR: " << path << " is not a complete garbled file\n";
+    std::exit(1);
+  }
+  length = mapped;
+  pos = header_size;
+}
+
+
+MmapLink::~MmapLink() {
+  if (data) { munmap(const_cast<std::byte*>(data), mapped); }
+}
+
+
+void MmapLink::send(std::span<const std::byte>) {
+  std::cerr << "ERROR: E cannot send while evaluating offline\n";
+  std::exit(1);
+}
+
+
+std::span<const std::byte> MmapLink::acquire(std::size_t n) {
+  if (n > remaining()) {
+    std::cerr << "ERROR: read past the end of the garbled file\n";
+    std::exit(1);
+  }
+  const auto out = std::span<const std::byte> { data + pos, n };
+  pos += n;
+  return out;
+}
+
+
+void MmapLink::recv(std::span<std::byte> s) {
+  std::memcpy(s.data(), acquire(s.size()).data(), s.size());
+}
@@ -0,0 +1,76 @@
+#ifndef FILE_LINK_H__
+#define FILE_LINK_H__
+
+
+#include "link.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+// Offline garbling. Garbling only ever sends from G to E, so G can write its
+// whole transcript (AND gate rows, seed tree sums, outer product messages) to
+// a file ahead of time, and E can later evaluate by reading that file through
+// MmapLink instead of a live connection. Labels for E's inputs must be
+// delivered separately; G's inputs and everything else are in the file.
+//
+// The file is a 16-byte header (magic, payload length) followed by the bytes
+// G sent, in order.
+
+
+constexpr std::uint64_t garbled_file_magic = 0x454c425241474f31; // "1OGARBLE"
+
+
+// G's end: appends everything sent to the file. Receiving is an error.
+class FileLink : public Link {
+public:
+  FileLink(const char* path);
+  ~FileLink();
+
+  FileLink(const FileLink&) = delete;
+  FileLink& operator=(const FileLink&) = delete;
+
+  void send(std::span<const std::byte>);
+  void recv(std::span<std::byte>);
+
+  // Writes out buffered bytes and the header; the file is complete after this.
+  void flush();
+
+  std::size_t size() const { return written + buffer.size(); }
+
+private:
+  int fd;
+  std::size_t written = 0;
+  std::vector<std::byte> buffer;
+};
+
+
+// E's end: serves a garbled file from a read-only mapping. Sending is an
+// error.
+class MmapLink : public Link {
+public:
+  MmapLink(const char* path);
+  ~MmapLink();
+
+  MmapLink(const MmapLink&) = delete;
+  MmapLink& operator=(const MmapLink&) = delete;
+
+  void send(std::span<const std::byte>);
+  void recv(std::span<std::byte>);
+
+  // Zero-copy read of the next n bytes; they stay valid for the life of the
+  // link.
+  std::span<const std::byte> acquire(std::size_t n);
+
+  std::size_t remaining() const { return length - pos; }
+
+private:
+  const std::byte* data = nullptr;
+  std::size_t mapped = 0;
+  std::size_t length = 0;
+  std::size_t pos = 0;
+};
+
+
+#endif
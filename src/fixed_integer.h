@@ -0,0 +1,172 @@
+#ifndef FIXED_INTEGER_H__
+#define FIXED_INTEGER_H__
+
+
+#include "integer.h"
+
+#include <array>
+#include <utility>
+#include <type_traits>
+
+
+// Calls f(std::integral_constant<std::size_t, i>) for i = 0, ..., n-1, with
+// the loop unrolled at compile time.
+template <std::size_t n, typename F>
+constexpr void unroll(F f) {
+  [&]<std::size_t... i>(std::index_sequence<i...>) {
+    (f(std::integral_constant<std::size_t, i> { }), ...);
+  }(std::make_index_sequence<n> { });
+}
+
+
+// A garbled w-bit integer in two's complement whose width is fixed at compile
+// time. Bit 0 is the least significant. Signedness only affects comparison
+// and right shift.
+template <Mode mode, std::size_t w, bool is_signed = false>
+struct Integer {
+public:
+  static_assert(w >= 1 && w <= 64);
+
+  static constexpr std::size_t width = w;
+
+  Integer() { }
+  explicit Integer(const ShareMatrix<mode>& m) {
+    assert(m.rows() == w && m.cols() == 1);
+    unroll<w>([&](auto i) { bits[i] = m[i]; });
+  }
+
+  static Integer constant(std::uint64_t x) {
+    Integer out;
+    unroll<w>([&](auto i) { out.bits[i] = Share<mode>::bit((x >> i) & 1); });
+    return out;
+  }
+
+  static Integer uniform() {
+    Integer out;
+    unroll<w>([&](auto i) { out.bits[i] = Share<mode>::uniform(); });
+    return out;
+  }
+
+  ShareMatrix<mode> matrix() const {
+    auto out = ShareMatrix<mode>::vector(w);
+    unroll<w>([&](auto i) { out[i] = bits[i]; });
+    return out;
+  }
+
+  Share<mode>& operator[](std::size_t i) { return bits[i]; }
+  const Share<mode>& operator[](std::size_t i) const { return bits[i]; }
+
+  Integer operator+(const Integer& o) const {
+    Integer out;
+    auto carry = Share<mode>::bit(false);
+    unroll<w>([&](auto i) {
+      const auto xc = bits[i] ^ carry;
+      out.bits[i] = xc ^ o.bits[i];
+      if constexpr (i + 1 < w) { carry ^= xc & (o.bits[i] ^ carry); }
+    });
+    return out;
+  }
+
+  Integer operator-(const Integer& o) const {
+    Integer out;
+    subtract(o, out);
+    return out;
+  }
+
+  Integer operator-() const { return constant(0) - *this; }
+
+  // Computed by a one-hot outer product and a carry-save tree.
+  Integer operator*(const Integer& o) const {
+    const auto x = matrix();
+    const auto y = o.matrix();
+    return Integer { integer_multiply<mode>(x, y) };
+  }
+
+  Integer operator^(const Integer& o) const {
+    Integer out;
+    unroll<w>([&](auto i) { out.bits[i] = bits[i] ^ o.bits[i]; });
+    return out;
+  }
+
+  Integer operator~() const {
+    Integer out;
+    unroll<w>([&](auto i) { out.bits[i] = ~bits[i]; });
+    return out;
+  }
+
+  // Shifts by a public amount are free.
+  Integer operator<<(std::size_t k) const {
+    Integer out;
+    unroll<w>([&](auto i) { if (i >= k) { out.bits[i] = bits[i - k]; } });
+    return out;
+  }
+
+  // Logical for unsigned integers, arithmetic for signed ones.
+  Integer operator>>(std::size_t k) const {
+    Integer out;
+    const auto fill = is_signed ? bits[w-1] : Share<mode>::bit(false);
+    unroll<w>([&](auto i) { out.bits[i] = i + k < w ? bits[i + k] : fill; });
+    return out;
+  }
+
+  Share<mode> operator<(const Integer& o) const {
+    Integer diff;
+    const auto borrow = subtract(o, diff);
+    if constexpr (is_signed) {
+      return borrow ^ bits[w-1] ^ o.bits[w-1];
+    } else {
+      return borrow;
+    }
+  }
+
+  Share<mode> operator>(const Integer& o) const { return o < *this; }
+  Share<mode> operator<=(const Integer& o) const { return ~(o < *this); }
+  Share<mode> operator>=(const Integer& o) const { return ~(*this < o); }
+
+  // w-1 AND gates in a tree of depth log(w).
+  Share<mode> operator==(const Integer& o) const {
+    std::vector<Share<mode>> eq(w);
+    unroll<w>([&](auto i) { eq[i] = ~(bits[i] ^ o.bits[i]); });
+    return and_tree<mode>(std::move(eq));
+  }
+
+  Share<mode> operator!=(const Integer& o) const { return ~(*this == o); }
+
+  // if s, x, else y
+  static Integer mux(const Share<mode>& s, const Integer& x, const Integer& y) {
+    std::array<Share<mode>, w> diff;
+    std::array<Share<mode>, w> sel;
+    unroll<w>([&](auto i) {
+      diff[i] = x.bits[i] ^ y.bits[i];
+      sel[i] = s;
+    });
+    and_gates<mode>(diff, sel, diff);
+
+    Integer out;
+    unroll<w>([&](auto i) { out.bits[i] = diff[i] ^ y.bits[i]; });
+    return out;
+  }
+
+private:
+  // Computes out = this - o and returns the borrow out of the top bit.
+  Share<mode> subtract(const Integer& o, Integer& out) const {
+    auto borrow = Share<mode>::bit(false);
+    unroll<w>([&](auto i) { out.bits[i] = subtract_bit<mode>(bits[i], o.bits[i], borrow); });
+    return borrow;
+  }
+
+  std::array<Share<mode>, w> bits;
+};
+
+
+template <Mode mode> using UInt8 = Integer<mode, 8>;
+template <Mode mode> using UInt16 = Integer<mode, 16>;
+template <Mode mode> using UInt32 = Integer<mode, 32>;
+template <Mode mode> using UInt64 = Integer<mode, 64>;
+template <Mode mode> using Int8 = Integer<mode, 8, true>;
+template <Mode mode> using Int16 = Integer<mode, 16, true>;
+template <Mode mode> using Int32 = Integer<mode, 32, true>;
+template <Mode mode> using Int64 = Integer<mode, 64, true>;
+
+
+#endif
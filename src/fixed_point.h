@@ -0,0 +1,373 @@
+#ifndef FIXED_POINT_H__
+#define FIXED_POINT_H__
+
+
+#include "fixed_integer.h"
+#include "compare.h"
+#include "division.h"
+
+#include <cmath>
+#include <bit>
+#include <algorithm>
+
+
+// A garbled signed fixed-point number: a w-bit two's complement integer whose
+// low f bits are the fraction. Row outputs of activation tables pack two
+// w-bit values, so w is limited to 32.
+template <Mode mode, std::size_t w, std::size_t f>
+struct Fixed {
+public:
+  static_assert(f < w && w <= 32);
+
+  using Int = Integer<mode, w, true>;
+
+  static constexpr std::size_t width = w;
+  static constexpr std::size_t fraction = f;
+
+  Fixed() { }
+  explicit Fixed(const Int& value) : value(value) { }
+  explicit Fixed(const ShareMatrix<mode>& m) : value(m) { }
+
+  // Rounds x to the nearest representable value, saturating at the ends of
+  // the range.
+  static std::int64_t encode(double x) {
+    const double top = std::ldexp(1, w - 1) - 1;
+    const double scaled = std::round(std::ldexp(x, f));
+    return static_cast<std::int64_t>(std::clamp(scaled, -top - 1, top));
+  }
+
+  static double decode(const Matrix& m) {
+    std::int64_t x = 0;
+    for (std::size_t i = 0; i < w; ++i) {
+      x |= std::int64_t { m[i] } << i;
+    }
+    x -= std::int64_t { m[w-1] } << w;
+    return std::ldexp(static_cast<double>(x), -static_cast<int>(f));
+  }
+
+  // Reduces an encoded value to w-bit two's complement, as garbled arithmetic
+  // does.
+  static std::int64_t wrap(std::int64_t x) {
+    const auto low = static_cast<std::uint64_t>(x) & ((std::uint64_t { 1 } << w) - 1);
+    return static_cast<std::int64_t>(low) - static_cast<std::int64_t>((low >> (w - 1)) << w);
+  }
+
+  static Fixed constant(double x) {
+    return Fixed { Int::constant(encode(x)) };
+  }
+
+  ShareMatrix<mode> matrix() const { return value.matrix(); }
+
+  Fixed operator+(const Fixed& o) const { return Fixed { value + o.value }; }
+  Fixed operator-(const Fixed& o) const { return Fixed { value - o.value }; }
+  Fixed operator-() const { return Fixed { -value }; }
+
+  // Shifts by a public amount are free.
+  Fixed operator<<(std::size_t k) const { return Fixed { value << k }; }
+  Fixed operator>>(std::size_t k) const { return Fixed { value >> k }; }
+
+  // The operands are sign-extended to w + f bits, so that the low w + f bits
+  // of the product are exact, and the result is truncated back to f
+  // fractional bits.
+  Fixed operator*(const Fixed& o) const {
+    constexpr auto n = w + f;
+    auto x = ShareMatrix<mode>::vector(n);
+    auto y = ShareMatrix<mode>::vector(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      x[i] = value[std::min(i, w - 1)];
+      y[i] = o.value[std::min(i, w - 1)];
+    }
+    const auto xy = integer_multiply<mode>(x, y);
+    return Fixed { integer_slice<mode>(xy, f, w, w) };
+  }
+
+  Share<mode> sign() const { return value[w-1]; }
+
+  Int value;
+};
+
+
+template <Mode mode> using Fixed16 = Fixed<mode, 16, 8>;
+template <Mode mode> using Fixed32 = Fixed<mode, 32, 16>;
+
+
+// Selects a if s, else b, for public a and b. Bit i is b_i + s (a_i + b_i),
+// so no gates are needed.
+template <Mode mode, std::size_t w, std::size_t f>
+Fixed<mode, w, f> select_constant(const Share<mode>& s, double a, double b) {
+  using F = Fixed<mode, w, f>;
+  const auto x = F::encode(a);
+  const auto y = F::encode(b);
+  F out;
+  for (std::size_t i = 0; i < w; ++i) {
+    out.value[i] = Share<mode>::bit((y >> i) & 1);
+    if (((x ^ y) >> i) & 1) { out.value[i] ^= s; }
+  }
+  return out;
+}
+
+
+// The number of fraction bits that select a segment of a piecewise linear
+// activation; each unit interval is split into 2^segment_bits segments.
+constexpr std::size_t segment_bits = 4;
+
+
+// Row i of the table behind a piecewise linear approximation of fn on
+// [-2^r, 2^r): the value at the start of segment i (low w bits) and the slope
+// over it (high w bits), both in fixed-point. Where fn leaves the range, the
+// slope is clipped so that value + slope * offset stays representable for
+// every offset into the segment, and so saturates rather than wraps.
+template <std::size_t w, std::size_t f>
+std::size_t piecewise_row(double (*fn)(double), std::size_t r, std::size_t i) {
+  using F = Fixed<Mode::G, w, f>;
+  const auto mask = (std::size_t { 1 } << w) - 1;
+  const auto top = (std::int64_t { 1 } << (w - 1)) - 1;
+  const auto step = std::ldexp(1, -static_cast<int>(segment_bits));
+
+  const auto s = i*step - std::ldexp(1, r);
+  const auto value = F::encode(fn(s));
+  const auto slope = std::clamp(
+      F::encode((fn(s + step) - fn(s)) / step),
+      (-top - 1 - value) * (std::int64_t { 1 } << segment_bits),
+      (top - value) * (std::int64_t { 1 } << segment_bits));
+  return (static_cast<std::size_t>(value) & mask) | ((static_cast<std::size_t>(slope) & mask) << w);
+}
+
+
+// The table behind a piecewise linear approximation of fn on [-2^r, 2^r). The
+// input is the offset (x + 2^r) 2^segment_bits.
+template <std::size_t w, std::size_t f>
+ExplicitTable piecewise_table(double (*fn)(double), std::size_t r) {
+  const auto k = r + 1 + segment_bits;
+  std::vector<std::size_t> rows(std::size_t { 1 } << k);
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    rows[i] = piecewise_row<w, f>(fn, r, i);
+  }
+  return { k, 2*w, std::move(rows) };
+}
+
+
+// Approximates fn(x) by a one-hot lookup over the integer bits and the top
+// segment_bits fraction bits of x, followed by a linear correction for the
+// remaining fraction bits. Inputs outside [-2^r, 2^r) saturate to fn(-2^r) or
+// fn(2^r).
+template <Mode mode, std::size_t w, std::size_t f>
+Fixed<mode, w, f> piecewise_linear(
+    const ExplicitTable& table, double (*fn)(double), std::size_t r, const Fixed<mode, w, f>& x) {
+  static_assert(f >= segment_bits);
+  using F = Fixed<mode, w, f>;
+  assert(f + r < w);
+
+  const auto lo = f - segment_bits;
+  const auto k = r + 1 + segment_bits;
+
+  // Bit f + r is the sign within the range; flipping it offsets the index.
+  auto index = ShareMatrix<mode>::vector(k);
+  for (std::size_t i = 0; i < k; ++i) { index[i] = x.value[lo + i]; }
+  index[k-1] = ~index[k-1];
+
+  const auto row = lookup<mode>(table, index);
+  const auto value = F { integer_slice<mode>(row, 0, w, w) };
+  const auto slope = F { integer_slice<mode>(row, w, w, w) };
+
+  // The offset into the segment is non-negative, so it is zero-extended.
+  const auto offset = F { integer_slice<mode>(x.matrix(), 0, lo, w) };
+  const auto approx = value + slope * offset;
+
+  const auto above = f + r;
+  if (above + 1 == w) { return approx; }
+
+  // x is in range when its bits from f + r up all match the sign.
+  auto high = ShareMatrix<mode>::vector(w - above);
+  for (std::size_t i = 0; i < w - above; ++i) {
+    high[i] = x.value[above + i] ^ x.sign();
+  }
+  const auto in_range = equal<mode>(high, ShareMatrix<mode>::vector(w - above));
+  const auto saturated = select_constant<mode, w, f>(
+      x.sign(), fn(-std::ldexp(1, r)), fn(std::ldexp(1, r)));
+  return F { swap<mode>(in_range, approx.matrix(), saturated.matrix()) };
+}
+
+
+// The same approximation on an encoded cleartext input, in wide arithmetic
+// that saturates at the ends of the range rather than wrapping: it is what the
+// garbled version must compute.
+template <std::size_t w, std::size_t f>
+std::int64_t piecewise_linear(double (*fn)(double), std::size_t r, std::int64_t x) {
+  using F = Fixed<Mode::G, w, f>;
+  const auto lo = f - segment_bits;
+  const auto half = std::int64_t { 1 } << (f + r);
+  if (x < -half) { return F::encode(fn(-std::ldexp(1, r))); }
+  if (x >= half) { return F::encode(fn(std::ldexp(1, r))); }
+
+  const auto row = piecewise_row<w, f>(fn, r, (x + half) >> lo);
+  const auto value = F::wrap(static_cast<std::int64_t>(row));
+  const auto slope = F::wrap(static_cast<std::int64_t>(row >> w));
+  const auto offset = x & ((std::int64_t { 1 } << lo) - 1);
+  const auto top = (std::int64_t { 1 } << (w - 1)) - 1;
+  return std::clamp(value + ((slope * offset) >> f), -top - 1, top);
+}
+
+
+template <Mode mode, std::size_t w, std::size_t f>
+Fixed<mode, w, f> relu(const Fixed<mode, w, f>& x) {
+  // Only the sign matters, so a multiplexer is cheaper than any lookup.
+  const auto zero = ShareMatrix<mode>::vector(w);
+  return Fixed<mode, w, f> { swap<mode>(x.sign(), zero, x.matrix()) };
+}
+
+template <std::size_t w, std::size_t f>
+std::int64_t relu(std::int64_t x) { return std::max<std::int64_t>(x, 0); }
+
+
+inline double sigmoid_fn(double x) { return 1 / (1 + std::exp(-x)); }
+inline double tanh_fn(double x) { return std::tanh(x); }
+inline double exp_fn(double x) { return std::exp(x); }
+
+
+// The tables of sigmoid and tanh cover [-2^r, 2^r) for these r; outside, they
+// saturate.
+constexpr std::size_t sigmoid_range = 3;
+constexpr std::size_t tanh_range = 2;
+
+template <Mode mode, std::size_t w, std::size_t f>
+Fixed<mode, w, f> sigmoid(const Fixed<mode, w, f>& x) {
+  static const auto table = piecewise_table<w, f>(sigmoid_fn, sigmoid_range);
+  return piecewise_linear<mode>(table, sigmoid_fn, sigmoid_range, x);
+}
+
+template <std::size_t w, std::size_t f>
+std::int64_t sigmoid(std::int64_t x) {
+  return piecewise_linear<w, f>(sigmoid_fn, sigmoid_range, x);
+}
+
+
+template <Mode mode, std::size_t w, std::size_t f>
+Fixed<mode, w, f> tanh(const Fixed<mode, w, f>& x) {
+  static const auto table = piecewise_table<w, f>(tanh_fn, tanh_range);
+  return piecewise_linear<mode>(table, tanh_fn, tanh_range, x);
+}
+
+template <std::size_t w, std::size_t f>
+std::int64_t tanh(std::int64_t x) {
+  return piecewise_linear<w, f>(tanh_fn, tanh_range, x);
+}
+
+
+// exp(-2^r) < 2^-f once 2^r >= f, so below the table's range the result
+// rounds to zero; above, and wherever exp exceeds the range within the table,
+// it saturates.
+template <std::size_t w, std::size_t f>
+constexpr std::size_t exp_range = std::min<std::size_t>(std::bit_width(f - 1), w - f - 1);
+
+template <Mode mode, std::size_t w, std::size_t f>
+Fixed<mode, w, f> exp(const Fixed<mode, w, f>& x) {
+  static const auto table = piecewise_table<w, f>(exp_fn, exp_range<w, f>);
+  return piecewise_linear<mode>(table, exp_fn, exp_range<w, f>, x);
+}
+
+template <std::size_t w, std::size_t f>
+std::int64_t exp(std::int64_t x) {
+  return piecewise_linear<w, f>(exp_fn, exp_range<w, f>, x);
+}
+
+
+// The seed of rsqrt is looked up on this many top bits of the normalized
+// input, whose top two bits are not both zero, so it is within 2^-(b-1).
+constexpr std::size_t rsqrt_seed_bits = 8;
+
+
+// Newton's method for 1/sqrt(x) takes a relative error e to 3/2 e^2 + 1/2 e^3.
+// Steps are added until the seed's error is below 2^-(3f/2), the relative
+// resolution of the largest result, 1/sqrt(2^-f); what remains is truncation
+// in the steps and the final shift, an ulp or two.
+template <std::size_t f>
+constexpr std::size_t rsqrt_newton_steps() {
+  double e = 1.0 / (1 << (rsqrt_seed_bits - 1));
+  std::size_t steps = 0;
+  for (; e >= 1.0 / (std::uint64_t { 1 } << (3*f/2)); ++steps) { e = 1.5*e*e + 0.5*e*e*e; }
+  return steps;
+}
+
+
+// Row c approximates 1/sqrt(t), where t is the value of a normalized input
+// whose top rsqrt_seed_bits (of n) are c, as a fixed-point number with g
+// fraction bits and width w. The value is taken at the middle of [c, c + 1).
+template <std::size_t w, std::size_t g>
+struct RsqrtTable : public Table {
+  RsqrtTable(std::size_t n) : n(n) { }
+
+  std::size_t operator()(std::size_t c) const {
+    const auto mid = std::ldexp(c + 0.5, static_cast<int>(n - rsqrt_seed_bits) - static_cast<int>(g));
+    return static_cast<std::size_t>(Fixed<Mode::G, w, g>::encode(1 / std::sqrt(mid)));
+  }
+
+  std::size_t n;
+};
+
+
+// 1/sqrt(x) for positive x. The magnitude bits of x are shifted left by an
+// even amount 2k, so that one of the top two is set, and read as a
+// fixed-point number t in [2^(w-3-g), 2^(w-1-g)) with g fraction bits. A
+// lookup on the leading bits of t seeds 1/sqrt(t), and Newton steps
+// y <- y (3/2 - (t y) y / 2) refine it at that precision, which is kept even
+// for tiny x, where y is largest. g has the parity of f, so that the result,
+// 1/sqrt(t) 2^((f + 2k - g)/2), is a shift of y by a secret amount.
+template <std::size_t w, std::size_t f>
+constexpr std::size_t rsqrt_fraction = (w - 3 - f) % 2 == 0 ? w - 3 : w - 4;
+
+template <Mode mode, std::size_t w, std::size_t f>
+Fixed<mode, w, f> rsqrt(const Fixed<mode, w, f>& x) {
+  constexpr auto n = w - 1;
+  constexpr auto g = rsqrt_fraction<w, f>;
+  static_assert(n >= rsqrt_seed_bits && g >= f);
+  using T = Fixed<mode, w, g>;
+
+  const auto z = leading_zeros<mode>(integer_slice<mode>(x.matrix(), 0, n, n));
+  const auto l = z.rows();
+  auto t = shift_left<mode>(integer_slice<mode>(x.matrix(), 0, n, n), z);
+  t = swap<mode>(z[0], integer_slice<mode>(t, 1, n - 1, n), t);
+
+  RsqrtTable<w, g> table { n };
+  auto y = T { lookup<mode>(table, w, integer_slice<mode>(t, n - rsqrt_seed_bits, rsqrt_seed_bits, rsqrt_seed_bits)) };
+  const auto tt = T { integer_slice<mode>(t, 0, n, w) };
+  const auto three_halves = T::constant(1.5);
+  for (std::size_t i = 0; i < rsqrt_newton_steps<f>(); ++i) {
+    y = y * (three_halves - (((tt * y) * y) >> 1));
+  }
+
+  // The result is y 2^(k - 3 (g - f)/2) in units of 2^-f.
+  constexpr auto down = 3*(g - f)/2;
+  constexpr auto wide = w + std::max(down, (n - 1)/2);
+  const auto scaled = shift_left<mode>(integer_slice<mode>(y.matrix(), 0, w, wide), integer_slice<mode>(z, 1, l - 1, l - 1));
+  return Fixed<mode, w, f> { integer_slice<mode>(scaled, down, w, w) };
+}
+
+// The same steps on an encoded cleartext input, truncating as the garbled
+// fixed-point arithmetic does.
+template <std::size_t w, std::size_t f>
+std::int64_t rsqrt(std::int64_t x) {
+  constexpr auto n = w - 1;
+  constexpr auto g = rsqrt_fraction<w, f>;
+  using T = Fixed<Mode::G, w, g>;
+  const auto mul = [](std::int64_t a, std::int64_t b) { return T::wrap((a * b) >> g); };
+
+  const auto z = n - std::bit_width(static_cast<std::uint64_t>(x));
+  auto t = x << z;
+  if (z % 2 == 1) { t >>= 1; }
+
+  auto y = static_cast<std::int64_t>(RsqrtTable<w, g> { n }(t >> (n - rsqrt_seed_bits)));
+  const auto three_halves = T::encode(1.5);
+  for (std::size_t i = 0; i < rsqrt_newton_steps<f>(); ++i) {
+    y = mul(y, T::wrap(three_halves - (mul(mul(t, y), y) >> 1)));
+  }
+
+  constexpr auto down = 3*(g - f)/2;
+  constexpr auto wide = w + std::max(down, (n - 1)/2);
+  const auto low = static_cast<std::uint64_t>(y) & ((std::uint64_t { 1 } << w) - 1);
+  const auto scaled = (low << (z / 2)) & ((std::uint64_t { 1 } << wide) - 1);
+  return Fixed<Mode::G, w, f>::wrap(static_cast<std::int64_t>(scaled >> down));
+}
+
+
+#endif
@@ -1,64 +1,133 @@
 #include "gf256.h"
 
 
-#include <vector>
-
-
-std::vector<std::uint8_t> init_mult_table() {
-  std::vector<std::uint8_t> table(1 << 16);
-
-  for (std::size_t x = 0; x < 256; ++x) {
-    for (std::size_t y = 0; y < 256; ++y) {
-      std::size_t a = x;
-      std::size_t b = y;
-      std::size_t c = 0;
-      for (std::size_t i = 0; i < 8; ++i) {
-        c ^= a & -(b & 1);
-        b >>= 1;
-        a <<= 1;
-        a ^= (0x11B & -(a >> 8));
-      }
-      const std::size_t index = x << 8 | y;
-      table[index] = c;
-    }
-  }
-  return table;
+#include <immintrin.h>
+#include <cassert>
+
+
+// Cleartext arithmetic in GF(256) with the AES polynomial x^8 + x^4 + x^3 + x + 1.
+// GFNI implements exactly this field, so when it is available we use it
+// directly. Otherwise we fall back to PCLMUL, and finally to a branchless
+// shift-and-add loop. None of the paths use lookup tables, so they do not
+// compete with label buffers for L1.
+
+
+#ifdef __GFNI__
+
+// The affine matrix that leaves its input unchanged; gf2p8affineinv with this
+// matrix is plain field inversion.
+constexpr long long identity_affine = 0x0102040810204080;
+
+
+std::uint8_t mul_gf256(std::uint8_t x, std::uint8_t y) {
+  const auto xx = _mm_cvtsi32_si128(x);
+  const auto yy = _mm_cvtsi32_si128(y);
+  return _mm_cvtsi128_si32(_mm_gf2p8mul_epi8(xx, yy));
 }
 
 
-std::vector<std::uint8_t> gf256_multiplication_table = init_mult_table();
+std::uint8_t invert_gf256(std::uint8_t x) {
+  const auto xx = _mm_cvtsi32_si128(x);
+  const auto id = _mm_set1_epi64x(identity_affine);
+  return _mm_cvtsi128_si32(_mm_gf2p8affineinv_epi64_epi8(xx, id, 0));
+}
+
+#else
 
+#ifdef __PCLMUL__
 
 std::uint8_t mul_gf256(std::uint8_t x, std::uint8_t y) {
-  std::size_t index = x;
-  index <<= 8;
-  index |= y;
-  return gf256_multiplication_table[index];
+  const auto poly = _mm_cvtsi32_si128(0x1B);
+
+  // The unreduced product has degree at most 14. Since x^8 = x^4 + x^3 + x + 1,
+  // two folds of the high bits bring it below degree 8.
+  const auto clmul = [&](__m128i a, __m128i b) -> std::uint32_t {
+    return _mm_cvtsi128_si32(_mm_clmulepi64_si128(a, b, 0));
+  };
+  std::uint32_t p = clmul(_mm_cvtsi32_si128(x), _mm_cvtsi32_si128(y));
+  p = (p & 0xFF) ^ clmul(_mm_cvtsi32_si128(p >> 8), poly);
+  p = (p & 0xFF) ^ clmul(_mm_cvtsi32_si128(p >> 8), poly);
+  return p;
 }
 
+#else
+
+std::uint8_t mul_gf256(std::uint8_t x, std::uint8_t y) {
+  std::uint32_t a = x;
+  std::uint32_t b = y;
+  std::uint32_t c = 0;
+  for (std::size_t i = 0; i < 8; ++i) {
+    c ^= a & -(b & 1);
+    b >>= 1;
+    a <<= 1;
+    a ^= (0x11B & -(a >> 8));
+  }
+  return c;
+}
 
-std::vector<std::uint8_t> init_invert_table() {
-  std::vector<std::uint8_t> table(1 << 8);
+#endif
 
-  for (std::size_t x = 0; x < 256; ++x) {
-    std::uint8_t z;
 
-    z = x;
-    for (std::size_t i = 0; i < 6; ++i) {
-      z = mul_gf256(z, z);
-      z = mul_gf256(z, x);
-    }
-    table[x] = mul_gf256(z, z);
+// x^254 = x^-1, and 0 maps to 0.
+std::uint8_t invert_gf256(std::uint8_t x) {
+  std::uint8_t z = x;
+  for (std::size_t i = 0; i < 6; ++i) {
+    z = mul_gf256(z, z);
+    z = mul_gf256(z, x);
   }
-  return table;
+  return mul_gf256(z, z);
 }
 
+#endif
 
-std::vector<std::uint8_t> gf256_invert_table = init_invert_table();
 
+void mul_gf256(
+    std::span<const std::uint8_t> x,
+    std::span<const std::uint8_t> y,
+    std::span<std::uint8_t> out) {
+  assert(x.size() == out.size());
+  assert(y.size() == out.size());
 
-std::uint8_t invert_gf256(std::uint8_t x) {
-  return gf256_invert_table[x];
+  std::size_t i = 0;
+#ifdef __GFNI__
+#ifdef __AVX2__
+  for (; i + 32 <= out.size(); i += 32) {
+    const auto xx = _mm256_loadu_si256((const __m256i*)(x.data() + i));
+    const auto yy = _mm256_loadu_si256((const __m256i*)(y.data() + i));
+    _mm256_storeu_si256((__m256i*)(out.data() + i), _mm256_gf2p8mul_epi8(xx, yy));
+  }
+#endif
+  for (; i + 16 <= out.size(); i += 16) {
+    const auto xx = _mm_loadu_si128((const __m128i*)(x.data() + i));
+    const auto yy = _mm_loadu_si128((const __m128i*)(y.data() + i));
+    _mm_storeu_si128((__m128i*)(out.data() + i), _mm_gf2p8mul_epi8(xx, yy));
+  }
+#endif
+  for (; i < out.size(); ++i) {
+    out[i] = mul_gf256(x[i], y[i]);
+  }
 }
 
 
+void invert_gf256(std::span<const std::uint8_t> x, std::span<std::uint8_t> out) {
+  assert(x.size() == out.size());
+
+  std::size_t i = 0;
+#ifdef __GFNI__
+#ifdef __AVX2__
+  const auto id256 = _mm256_set1_epi64x(identity_affine);
+  for (; i + 32 <= out.size(); i += 32) {
+    const auto xx = _mm256_loadu_si256((const __m256i*)(x.data() + i));
+    _mm256_storeu_si256((__m256i*)(out.data() + i), _mm256_gf2p8affineinv_epi64_epi8(xx, id256, 0));
+  }
+#endif
+  const auto id = _mm_set1_epi64x(identity_affine);
+  for (; i + 16 <= out.size(); i += 16) {
+    const auto xx = _mm_loadu_si128((const __m128i*)(x.data() + i));
+    _mm_storeu_si128((__m128i*)(out.data() + i), _mm_gf2p8affineinv_epi64_epi8(xx, id, 0));
+  }
+#endif
+  for (; i < out.size(); ++i) {
+    out[i] = invert_gf256(x[i]);
+  }
+}
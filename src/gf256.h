@@ -3,10 +3,19 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <span>
 
 
 std::uint8_t mul_gf256(std::uint8_t, std::uint8_t);
 std::uint8_t invert_gf256(std::uint8_t);
 
 
+// Elementwise batch versions. All spans must have the same length.
+void mul_gf256(
+    std::span<const std::uint8_t>,
+    std::span<const std::uint8_t>,
+    std::span<std::uint8_t>);
+void invert_gf256(std::span<const std::uint8_t>, std::span<std::uint8_t>);
+
+
 #endif
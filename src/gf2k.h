@@ -0,0 +1,224 @@
+#ifndef GF2K_H__
+#define GF2K_H__
+
+
+#include "share_matrix.h"
+#include "unary_outer_product.h"
+#include "table.h"
+
+#include <cstdint>
+#include <bit>
+#include <vector>
+
+
+// The field GF(2^k) = GF(2)[x]/(poly), where poly is irreducible of degree k
+// and includes the x^k term.
+// Elements are k-bit integers where bit i is the coefficient of x^i. Garbled
+// elements are vectors of k shares in the same order.
+template <std::size_t k, std::uint64_t poly>
+struct GF2k {
+  static_assert(k >= 2 && k <= 32);
+  static_assert(poly >> k == 1);
+
+  static constexpr std::size_t degree = k;
+
+  static constexpr std::uint32_t mul(std::uint32_t x, std::uint32_t y) {
+    std::uint64_t a = x;
+    std::uint64_t c = 0;
+    for (std::size_t i = 0; i < k; ++i) {
+      c ^= a & -std::uint64_t { (y >> i) & 1 };
+      a <<= 1;
+      a ^= poly & -(a >> k);
+    }
+    return c;
+  }
+
+  // x^(2^k - 2); 0 maps to 0
+  static constexpr std::uint32_t invert(std::uint32_t x) {
+    std::uint32_t out = 1;
+    std::uint64_t e = (std::uint64_t { 1 } << k) - 2;
+    while (e > 0) {
+      if (e & 1) { out = mul(out, x); }
+      x = mul(x, x);
+      e >>= 1;
+    }
+    return out;
+  }
+
+  static Matrix to_vector(std::uint32_t x) {
+    auto out = Matrix::vector(k);
+    for (std::size_t i = 0; i < k; ++i) {
+      out[i] = (x >> i) & 1;
+    }
+    return out;
+  }
+
+  static std::uint32_t from_vector(const Matrix& v) {
+    std::uint32_t out = 0;
+    for (std::size_t i = 0; i < k; ++i) {
+      out |= std::uint32_t { v[i] } << i;
+    }
+    return out;
+  }
+
+  // The k x (2k-1) matrix that reduces an unreduced product modulo poly.
+  // Column j holds x^j mod poly.
+  static Matrix reduction_matrix() {
+    Matrix out(k, 2*k - 1);
+    std::uint64_t xj = 1;
+    for (std::size_t j = 0; j < 2*k - 1; ++j) {
+      for (std::size_t i = 0; i < k; ++i) {
+        out(i, j) = (xj >> i) & 1;
+      }
+      xj <<= 1;
+      xj ^= poly & -(xj >> k);
+    }
+    return out;
+  }
+
+  // The k x k matrix of the (linear) Frobenius map x -> x^2.
+  static Matrix square_matrix() {
+    Matrix out(k, k);
+    for (std::size_t j = 0; j < k; ++j) {
+      const auto x2j = mul(std::uint32_t { 1 } << j, std::uint32_t { 1 } << j);
+      for (std::size_t i = 0; i < k; ++i) {
+        out(i, j) = (x2j >> i) & 1;
+      }
+    }
+    return out;
+  }
+};
+
+
+using GF16 = GF2k<4, 0x13>; // x^4 + x + 1
+using GF256 = GF2k<8, 0x11B>; // x^8 + x^4 + x^3 + x + 1 (AES)
+using GF65536 = GF2k<16, 0x1100B>; // x^16 + x^12 + x^3 + x + 1
+using GF2_32 = GF2k<32, 0x100400007>; // x^32 + x^22 + x^2 + x + 1
+
+
+// Multiply (x + color(x)) by y in F
+template <typename F, Mode mode>
+ShareMatrix<mode> half_mul(const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
+  constexpr auto k = F::degree;
+  assert(x.rows() == k);
+  assert(y.rows() == k);
+
+  static const Matrix reduction = F::reduction_matrix();
+
+  const auto xy_outer = half_outer_product<mode>(x, y);
+
+  // The vector of coefficients of x*y without modular reduction.
+  auto unreduced = ShareMatrix<mode>::vector(2*k - 1);
+  for (std::size_t i = 0; i < k; ++i) {
+    for (std::size_t j = 0; j < k; ++j) {
+      unreduced[i + j] ^= xy_outer(i, j);
+    }
+  }
+  return reduction * unreduced;
+}
+
+
+// Multiply x by y in F
+template <typename F, Mode mode>
+ShareMatrix<mode> mul(const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
+  return
+    half_mul<F>(x, y) ^
+    half_mul<F>(y, ShareMatrix<mode>::constant(color<mode>(x))) ^
+    ShareMatrix<mode>::constant(
+        F::to_vector(
+          F::mul(
+            F::from_vector(color<mode>(x)),
+            F::from_vector(color<mode>(y)))));
+}
+
+
+template <typename F, Mode mode>
+ShareMatrix<mode> square(const ShareMatrix<mode>& x) {
+  static const Matrix sq = F::square_matrix();
+  return sq * x;
+}
+
+
+// The workers read the table once per leaf and column, so the rows are
+// computed once per field rather than on every call.
+template <typename F>
+struct FieldInverseTable : public Table {
+  std::size_t operator()(std::size_t i) const {
+    return rows[i];
+  }
+
+  static const std::vector<std::uint32_t>& inverses() {
+    static const std::vector<std::uint32_t> out = [] {
+      std::vector<std::uint32_t> out(std::size_t { 1 } << F::degree);
+      for (std::size_t i = 0; i < out.size(); ++i) { out[i] = F::invert(i); }
+      return out;
+    }();
+    return out;
+  }
+
+  const std::vector<std::uint32_t>& rows = inverses();
+};
+
+
+// Fields up to this degree are inverted by a single one-hot lookup over
+// all 2^k elements. Larger fields use an addition chain of multiplications.
+constexpr std::size_t max_one_hot_inverse_degree = 16;
+
+
+// input x must be known to be non-zero
+template <typename F, Mode mode>
+ShareMatrix<mode> invert(const ShareMatrix<mode>& x) {
+  constexpr auto k = F::degree;
+  assert(x.rows() == k);
+
+  if constexpr (k <= max_one_hot_inverse_degree) {
+    static const Matrix reduction = F::reduction_matrix();
+
+    auto y = ShareMatrix<mode>::vector(k);
+
+    // G draws a uniform, non-zero value.
+    if constexpr (mode == Mode::G) {
+      while (F::from_vector(color<mode>(y)) == 0) {
+        y = ShareMatrix<mode>::uniform(k, 1);
+      }
+    }
+
+    auto xy = half_mul<F>(x, y) ^ ShareMatrix<mode>::constant(
+        F::to_vector(F::mul(F::from_vector(color<mode>(x)), F::from_vector(color<mode>(y)))));
+
+    // It is secure to show x*y to E
+    xy.reveal();
+
+    FieldInverseTable<F> inv;
+    ShareMatrix<mode> xy_outer(k, k);
+    unary_outer_product<mode>(inv, xy, y, xy_outer);
+
+    auto unreduced = ShareMatrix<mode>::vector(2*k - 1);
+    for (std::size_t i = 0; i < k; ++i) {
+      for (std::size_t j = 0; j < k; ++j) {
+        unreduced[i + j] ^= xy_outer(i, j);
+      }
+    }
+    return reduction * unreduced;
+  } else {
+    // Itoh-Tsujii: x^-1 = (x^(2^(k-1) - 1))^2. Let b(m) = x^(2^m - 1); then
+    // b(2m) = b(m)^(2^m) * b(m) and b(m+1) = b(m)^2 * x. Squaring is linear,
+    // so only the multiplications cost anything.
+    auto b = x;
+    std::size_t m = 1;
+    for (int bit = std::bit_width(k - 1) - 2; bit >= 0; --bit) {
+      auto b2m = b;
+      for (std::size_t i = 0; i < m; ++i) { b2m = square<F, mode>(b2m); }
+      b = mul<F, mode>(b2m, b);
+      m *= 2;
+      if (((k - 1) >> bit) & 1) {
+        b = mul<F, mode>(square<F, mode>(b), x);
+        m += 1;
+      }
+    }
+    return square<F, mode>(b);
+  }
+}
+
+
+#endif
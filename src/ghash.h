@@ -0,0 +1,133 @@
+#ifndef GHASH_H__
+#define GHASH_H__
+
+
+#include "share_matrix.h"
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+
+// The GHASH field GF(2^128) = GF(2)[x]/(x^128 + x^7 + x^2 + x + 1).
+// Following the GCM specification, bit i of an element is the coefficient of
+// x^i, and bit i of a 16-byte block is bit 7 - i%8 of byte i/8. Garbled
+// elements are vectors of 128 shares in coefficient order.
+
+
+inline Matrix block_to_vector(const std::array<std::uint8_t, 16>& b) {
+  auto v = Matrix::vector(128);
+  for (std::size_t i = 0; i < 128; ++i) {
+    v[i] = (b[i/8] >> (7 - i%8)) & 1;
+  }
+  return v;
+}
+
+
+inline std::array<std::uint8_t, 16> vector_to_block(const Matrix& v) {
+  std::array<std::uint8_t, 16> b { };
+  for (std::size_t i = 0; i < 128; ++i) {
+    b[i/8] |= v[i] << (7 - i%8);
+  }
+  return b;
+}
+
+
+// Multiply in GF(2^128), as in Algorithm 1 of the GCM specification.
+inline Matrix mul_gf128(const Matrix& x, const Matrix& y) {
+  auto z = Matrix::vector(128);
+  auto v = y;
+  for (std::size_t i = 0; i < 128; ++i) {
+    if (x[i]) { z ^= v; }
+    const bool carry = v[127];
+    for (std::size_t j = 127; j > 0; --j) { v[j] = v[j-1]; }
+    v[0] = 0;
+    if (carry) {
+      v[0] = !v[0]; v[1] = !v[1]; v[2] = !v[2]; v[7] = !v[7];
+    }
+  }
+  return z;
+}
+
+
+// Reduce a product of degree at most 254 modulo x^128 + x^7 + x^2 + x + 1.
+// Since x^128 = x^7 + x^2 + x + 1, each high coefficient folds into four lower
+// ones. Folding from the top down handles the coefficients that land above
+// x^127 again, so the whole reduction is a fixed sequence of XORs.
+template <Mode mode>
+ShareMatrix<mode> reduce_gf128(ShareMatrix<mode> unreduced) {
+  assert(unreduced.rows() == 255);
+  for (std::size_t i = 254; i >= 128; --i) {
+    const auto hi = unreduced[i];
+    unreduced[i - 128] ^= hi;
+    unreduced[i - 127] ^= hi;
+    unreduced[i - 126] ^= hi;
+    unreduced[i - 121] ^= hi;
+  }
+
+  auto out = ShareMatrix<mode>::vector(128);
+  for (std::size_t i = 0; i < 128; ++i) { out[i] = unreduced[i]; }
+  return out;
+}
+
+
+// Multiply x by y in GF(2^128). The 128 x 128 outer product is computed by
+// chunked one-hot half outer products; the rest is XOR.
+template <Mode mode>
+ShareMatrix<mode> mul_gf128(const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
+  assert(x.rows() == 128);
+  assert(y.rows() == 128);
+
+  const auto xy_outer = outer_product<mode>(x, y);
+
+  auto unreduced = ShareMatrix<mode>::vector(255);
+  for (std::size_t i = 0; i < 128; ++i) {
+    for (std::size_t j = 0; j < 128; ++j) {
+      unreduced[i + j] ^= xy_outer(i, j);
+    }
+  }
+  return reduce_gf128<mode>(std::move(unreduced));
+}
+
+
+// GHASH_H(X_1, ..., X_m) = sum_i X_i * H^(m-i+1), evaluated by Horner's rule.
+template <Mode mode>
+ShareMatrix<mode> ghash(
+    const ShareMatrix<mode>& h,
+    const std::vector<ShareMatrix<mode>>& blocks) {
+  auto y = ShareMatrix<mode>::vector(128);
+  for (const auto& x: blocks) {
+    y = mul_gf128<mode>(y ^ x, h);
+  }
+  return y;
+}
+
+
+// The AES-GCM authentication tag GHASH_H(A || C || len(A) || len(C)) + E_K(J0).
+// The hash key h = E_K(0^128) and the mask ek_j0 = E_K(J0) are garbled inputs;
+// A and C must already be padded to whole blocks, while the bit lengths are
+// public.
+template <Mode mode>
+ShareMatrix<mode> gcm_tag(
+    const ShareMatrix<mode>& h,
+    const ShareMatrix<mode>& ek_j0,
+    const std::vector<ShareMatrix<mode>>& aad,
+    const std::vector<ShareMatrix<mode>>& ciphertext,
+    std::uint64_t aad_bits,
+    std::uint64_t ciphertext_bits) {
+  std::array<std::uint8_t, 16> lengths;
+  for (std::size_t i = 0; i < 8; ++i) {
+    lengths[7 - i] = aad_bits >> (8*i);
+    lengths[15 - i] = ciphertext_bits >> (8*i);
+  }
+
+  std::vector<ShareMatrix<mode>> blocks;
+  blocks.insert(blocks.end(), aad.begin(), aad.end());
+  blocks.insert(blocks.end(), ciphertext.begin(), ciphertext.end());
+  blocks.push_back(ShareMatrix<mode>::constant(block_to_vector(lengths)));
+
+  return ghash<mode>(h, blocks) ^ ek_j0;
+}
+
+
+#endif
@@ -4,6 +4,9 @@
 
 #include "share_matrix.h"
 
+#include <vector>
+#include <utility>
+
 inline Matrix from_uint32(std::uint32_t x) {
   auto out = Matrix::vector(32);
   for (std::size_t i = 0; i < 32; ++i) {
@@ -36,7 +39,27 @@ inline Matrix from_uint64(std::uint64_t x) {
 inline std::uint64_t to_uint64(const Matrix& m) {
   std::uint64_t out = 0;
   for (std::size_t i = 0; i < 64; ++i) {
-    out |= (m[i] << i);
+    out |= (std::uint64_t { m[i] } << i);
+  }
+  return out;
+}
+
+
+// Little-endian 64-bit limbs to an n-bit vector (and back), for integers wider
+// than 64 bits.
+inline Matrix from_limbs(const std::vector<std::uint64_t>& limbs, std::size_t n) {
+  auto out = Matrix::vector(n);
+  for (std::size_t i = 0; i < n && i/64 < limbs.size(); ++i) {
+    out[i] = (limbs[i/64] >> (i%64)) & 1;
+  }
+  return out;
+}
+
+
+inline std::vector<std::uint64_t> to_limbs(const Matrix& m) {
+  std::vector<std::uint64_t> out((m.rows() + 63)/64);
+  for (std::size_t i = 0; i < m.rows(); ++i) {
+    out[i/64] |= std::uint64_t { m[i] } << (i%64);
   }
   return out;
 }
@@ -54,6 +77,7 @@ ShareMatrix<mode> integer_add(
   assert (x.rows() >= n);
   assert (y.rows() >= n);
 
+  Phase phase { "and gates" };
   auto out = ShareMatrix<mode>::vector(n);
 
   auto carry = Share<mode>::bit(false);
@@ -75,6 +99,18 @@ ShareMatrix<mode> integer_add(
 }
 
 
+// One bit of a ripple subtraction: returns x - y - borrow and updates borrow
+// to the borrow out, with one AND gate.
+template <Mode mode>
+Share<mode> subtract_bit(const Share<mode>& x, const Share<mode>& y, Share<mode>& borrow) {
+  const auto xy = x ^ y;
+  const auto yc = borrow ^ y;
+  const auto out = xy ^ borrow;
+  borrow ^= xy & yc;
+  return out;
+}
+
+
 template <Mode mode>
 ShareMatrix<mode> integer_sub(
     const MatrixView<const Share<mode>>& x,
@@ -84,47 +120,301 @@ ShareMatrix<mode> integer_sub(
   assert (y.cols() == 1);
   assert (y.rows() == n);
 
+  Phase phase { "and gates" };
   auto out = ShareMatrix<mode>::vector(n);
 
   auto borrow = Share<mode>::bit(false);
-  for (std::size_t i = 0; i < n-1; ++i) {
-    const auto xy = x[i] ^ y[i];
-    const auto yc = borrow ^ y[i];
-    out[i] = xy ^ borrow;
-    borrow ^= xy & yc;
-  }
+  for (std::size_t i = 0; i < n-1; ++i) { out[i] = subtract_bit<mode>(x[i], y[i], borrow); }
   out[n-1] = x[n-1] ^ y[n-1] ^ borrow;
   return out;
 }
 
 
+// The AND of all of x, from x.size() - 1 AND gates in a tree of depth
+// log(x.size()); each level is garbled together.
+template <Mode mode>
+Share<mode> and_tree(std::vector<Share<mode>> x) {
+  assert(!x.empty());
+  while (x.size() > 1) {
+    const auto half = x.size() / 2;
+    std::vector<Share<mode>> lo(x.begin(), x.begin() + half);
+    std::vector<Share<mode>> hi(x.begin() + half, x.begin() + 2*half);
+    std::vector<Share<mode>> next(half);
+    and_gates<mode>(lo, hi, next);
+    if (x.size() % 2 == 1) { next.push_back(x.back()); }
+    x = std::move(next);
+  }
+  return x[0];
+}
+
+
+
+// A layer of full adders: computes a[i] + b[i] + c[i] for every i.
+// Each adder needs one AND gate, and the gates of the whole layer are garbled
+// together.
+template <Mode mode>
+void full_adders(
+    const std::vector<Share<mode>>& a,
+    const std::vector<Share<mode>>& b,
+    const std::vector<Share<mode>>& c,
+    std::vector<Share<mode>>& sum,
+    std::vector<Share<mode>>& carry) {
+  const auto k = a.size();
+  assert(b.size() == k);
+  assert(c.size() == k);
+
+  std::vector<Share<mode>> ac(k);
+  std::vector<Share<mode>> bc(k);
+  sum.resize(k);
+  for (std::size_t i = 0; i < k; ++i) {
+    ac[i] = a[i] ^ c[i];
+    bc[i] = b[i] ^ c[i];
+    sum[i] = ac[i] ^ b[i];
+  }
+
+  // carry = maj(a, b, c) = ((a + c) & (b + c)) + c
+  carry.resize(k);
+  and_gates<mode>(ac, bc, carry);
+  for (std::size_t i = 0; i < k; ++i) {
+    carry[i] ^= c[i];
+  }
+}
+
+
+// Sums several sets of bits, each modulo 2^n for its own n, where
+// sums[s][i] holds the bits of weight 2^i of the s-th sum. A carry-save
+// (Wallace) tree of full adders reduces every column to at most two bits, one
+// level at a time, and ripple-carry adders finish the sums. Each level of full
+// adders, and each bit position of the final adders, is garbled as one batch
+// across all the sums, so independent sums share their round trips.
+template <Mode mode>
+std::vector<ShareMatrix<mode>> sum_columns_batch(
+    std::vector<std::vector<std::vector<Share<mode>>>> sums) {
+  while (true) {
+    std::vector<Share<mode>> a, b, c;
+    std::vector<std::pair<std::size_t, std::size_t>> weight;
+    std::vector<std::vector<std::vector<Share<mode>>>> next(sums.size());
+    for (std::size_t s = 0; s < sums.size(); ++s) {
+      auto& columns = sums[s];
+      const auto n = columns.size();
+
+      // Carries out of the top column are discarded, so it reduces for free.
+      for (std::size_t i = 1; i < columns[n-1].size(); ++i) {
+        columns[n-1][0] ^= columns[n-1][i];
+      }
+      columns[n-1].resize(std::min<std::size_t>(columns[n-1].size(), 1));
+
+      next[s].resize(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        std::size_t j = 0;
+        for (; j + 3 <= columns[i].size(); j += 3) {
+          a.push_back(columns[i][j]);
+          b.push_back(columns[i][j+1]);
+          c.push_back(columns[i][j+2]);
+          weight.push_back({ s, i });
+        }
+        for (; j < columns[i].size(); ++j) {
+          next[s][i].push_back(columns[i][j]);
+        }
+      }
+    }
+    if (weight.empty()) { break; }
+
+    std::vector<Share<mode>> sum, carry;
+    full_adders<mode>(a, b, c, sum, carry);
+    for (std::size_t k = 0; k < weight.size(); ++k) {
+      const auto [s, i] = weight[k];
+      next[s][i].push_back(sum[k]);
+      if (i + 1 < next[s].size()) { next[s][i + 1].push_back(carry[k]); }
+    }
+    sums = std::move(next);
+  }
+
+  std::size_t width = 0;
+  std::vector<ShareMatrix<mode>> out;
+  std::vector<Share<mode>> carries(sums.size());
+  for (const auto& columns: sums) {
+    width = std::max(width, columns.size());
+    out.push_back(ShareMatrix<mode>::vector(columns.size()));
+  }
+
+  // The final adders run in lock step, one batch of carries per bit.
+  for (std::size_t i = 0; i < width; ++i) {
+    std::vector<Share<mode>> xc, yc;
+    std::vector<std::size_t> active;
+    for (std::size_t s = 0; s < sums.size(); ++s) {
+      if (i >= sums[s].size()) { continue; }
+      const auto& column = sums[s][i];
+      const auto x = column.size() > 0 ? column[0] : Share<mode>::bit(false);
+      const auto y = column.size() > 1 ? column[1] : Share<mode>::bit(false);
+      out[s][i] = x ^ y ^ carries[s];
+      if (i + 1 < sums[s].size()) {
+        xc.push_back(x ^ carries[s]);
+        yc.push_back(y ^ carries[s]);
+        active.push_back(s);
+      }
+    }
+    std::vector<Share<mode>> carry(active.size());
+    and_gates<mode>(xc, yc, carry);
+    for (std::size_t k = 0; k < active.size(); ++k) {
+      carries[active[k]] ^= carry[k];
+    }
+  }
+  return out;
+}
+
+
+// Sums a set of bits modulo 2^n, where columns[i] holds the bits of weight 2^i.
+template <Mode mode>
+ShareMatrix<mode> sum_columns(std::vector<std::vector<Share<mode>>> columns) {
+  std::vector<std::vector<std::vector<Share<mode>>>> sums;
+  sums.push_back(std::move(columns));
+  return std::move(sum_columns_batch<mode>(std::move(sums))[0]);
+}
+
+
+// Computes the low w bits of the product of an n-bit x and an m-bit y, for
+// any w up to n + m. Only the partial products x[i]*y[j] with i + j < w are
+// garbled, and carries out of bit w - 1 are never computed.
+template <Mode mode>
+ShareMatrix<mode> integer_multiply(
+    const MatrixView<const Share<mode>>& x,
+    const MatrixView<const Share<mode>>& y,
+    std::size_t w) {
+  assert(x.cols() == 1);
+  assert(y.cols() == 1);
+  assert(w <= x.rows() + y.rows());
+
+  const auto xy = triangle_outer_product<mode>(x, y, w);
+
+  // The partial product x[i]*y[j] has weight 2^(i+j).
+  std::vector<std::vector<Share<mode>>> columns(w);
+  for (std::size_t i = 0; i < x.rows() && i < w; ++i) {
+    for (std::size_t j = 0; j < y.rows() && i + j < w; ++j) {
+      columns[i + j].push_back(xy(i, j));
+    }
+  }
+  return sum_columns<mode>(std::move(columns));
+}
 
+
+// Computes x*y mod 2^n for n-bit x and y.
 template <Mode mode>
 ShareMatrix<mode> integer_multiply(
     const MatrixView<const Share<mode>>& x,
     const MatrixView<const Share<mode>>& y) {
-  const auto n = x.rows();
+  assert(y.rows() == x.rows());
+  return integer_multiply<mode>(x, y, x.rows());
+}
+
+
+// Computes the full n + m bit product of an n-bit x and an m-bit y.
+template <Mode mode>
+ShareMatrix<mode> integer_multiply_wide(
+    const MatrixView<const Share<mode>>& x,
+    const MatrixView<const Share<mode>>& y) {
+  return integer_multiply<mode>(x, y, x.rows() + y.rows());
+}
+
+
+// Computes x[k] * y[k] mod 2^n for every k. The products are independent, so
+// their carry-save trees are reduced together and share every round trip.
+template <Mode mode>
+std::vector<ShareMatrix<mode>> integer_multiply_batch(
+    const std::vector<ShareMatrix<mode>>& x,
+    const std::vector<ShareMatrix<mode>>& y) {
+  assert(x.size() == y.size());
+
+  std::vector<std::vector<std::vector<Share<mode>>>> sums;
+  for (std::size_t k = 0; k < x.size(); ++k) {
+    const auto n = x[k].rows();
+    assert(y[k].rows() == n);
+
+    const auto xy = triangle_outer_product<mode>(x[k], y[k], n);
+
+    std::vector<std::vector<Share<mode>>> columns(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; i + j < n; ++j) {
+        columns[i + j].push_back(xy(i, j));
+      }
+    }
+    sums.push_back(std::move(columns));
+  }
+  return sum_columns_batch<mode>(std::move(sums));
+}
+
 
+// Below this width, karatsuba_multiply computes the product directly from a
+// one-hot outer product.
+inline std::size_t& karatsuba_threshold() {
+  static std::size_t threshold = 24;
+  return threshold;
+}
+
+
+// The `len` bits of x starting at bit `start`, zero-extended to `width` bits.
+template <Mode mode>
+ShareMatrix<mode> integer_slice(
+    const ShareMatrix<mode>& x, std::size_t start, std::size_t len, std::size_t width) {
+  auto out = ShareMatrix<mode>::vector(width);
+  for (std::size_t i = 0; i < std::min(len, width) && start + i < x.rows(); ++i) {
+    out[i] = x[start + i];
+  }
+  return out;
+}
+
+
+// Computes the full 2n-bit product of two n-bit integers.
+// Each level splits the operands in half, x = x1*2^h + x0, and uses three
+// half-width products:
+//   x*y = z2*2^2h + (z1 - z2 - z0)*2^h + z0
+// where z0 = x0*y0, z2 = x1*y1 and z1 = (x0 + x1)*(y0 + y1).
+template <Mode mode>
+ShareMatrix<mode> karatsuba_multiply(const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
+  const auto n = x.rows();
   assert(x.cols() == 1);
   assert(y.cols() == 1);
   assert(y.rows() == n);
 
-  const auto xy = outer_product<mode>(x, y);
-  MatrixView<const Share<mode>> xy_view = xy;
-
-  auto sum = ShareMatrix<mode>::vector(1);
-  sum[0] = xy(n-1, n-1);
-
-  for (std::size_t i = 1; i < n; ++i) {
-    auto sum_swap = ShareMatrix<mode>::vector(sum.rows() + 1);
-    for (std::size_t j = 0; j < sum.rows(); ++j) {
-      sum_swap[j+1] = sum[j];
+  if (n <= karatsuba_threshold()) {
+    const auto xy = outer_product<mode>(x, y);
+    std::vector<std::vector<Share<mode>>> columns(2*n);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        columns[i + j].push_back(xy(i, j));
+      }
     }
-    sum = sum_swap;
-    MatrixView<const Share<mode>> sum_view = sum;
-    sum = integer_add(i+1, sum_view, row(n-i-1, xy_view));
+    return sum_columns<mode>(std::move(columns));
   }
-  return sum;
+
+  const auto h = (n + 1)/2;
+
+  const auto x0 = integer_slice<mode>(x, 0, h, h + 1);
+  const auto x1 = integer_slice<mode>(x, h, n - h, h + 1);
+  const auto y0 = integer_slice<mode>(y, 0, h, h + 1);
+  const auto y1 = integer_slice<mode>(y, h, n - h, h + 1);
+
+  const auto z0 = karatsuba_multiply<mode>(
+      integer_slice<mode>(x0, 0, h, h), integer_slice<mode>(y0, 0, h, h));
+  const auto z2 = karatsuba_multiply<mode>(
+      integer_slice<mode>(x1, 0, h, h), integer_slice<mode>(y1, 0, h, h));
+  const auto z1 = karatsuba_multiply<mode>(integer_add<mode>(x0, x1), integer_add<mode>(y0, y1));
+
+  // z1 - z0 - z2 is exact in 2h + 2 bits
+  const auto w = 2*h + 2;
+  auto mid = integer_sub<mode>(z1, integer_slice<mode>(z0, 0, 2*h, w));
+  mid = integer_sub<mode>(mid, integer_slice<mode>(z2, 0, 2*h, w));
+
+  // z0 and z2*2^2h do not overlap, so only the middle term needs an adder.
+  auto out = ShareMatrix<mode>::vector(2*n);
+  for (std::size_t i = 0; i < 2*h; ++i) { out[i] = z0[i]; }
+  for (std::size_t i = 2*h; i < 2*n; ++i) { out[i] = z2[i - 2*h]; }
+
+  const auto high = integer_add<mode>(
+      integer_slice<mode>(out, h, 2*n - h, 2*n - h),
+      integer_slice<mode>(mid, 0, w, 2*n - h));
+  for (std::size_t i = h; i < 2*n; ++i) { out[i] = high[i - h]; }
+  return out;
 }
 
 
@@ -167,18 +457,32 @@ ShareMatrix<mode> naive_integer_multiply(
 }
 
 
+constexpr std::uint32_t pow32(std::uint32_t x, std::uint32_t p) {
+  if (p == 0) return 1;
+  if (p == 1) return x;
+  
+  std::uint32_t tmp = pow32(x, p/2);
+  if (p % 2 == 0) return tmp * tmp;
+  else return x * tmp * tmp;
+}
+
+
+// Square-and-multiply: factor i is x^(2^i) where bit i of y is set and 1
+// elsewhere, selected with one AND gate per bit.
 template <Mode mode>
 ShareMatrix<mode> naive_exponent(std::uint32_t x, const ShareMatrix<mode>& y) {
-  auto out = ShareMatrix<mode>::constant(from_uint32(x));
-  for (std::size_t i = 0; i < 32; ++i) {
-    out[i] &= y[0];
-  }
+  const auto one = ShareMatrix<mode>::constant(from_uint32(1));
+  const auto factor = [&](std::size_t i) {
+    auto out = ShareMatrix<mode>::constant(from_uint32(pow32(x, 1u << i) ^ 1));
+    for (std::size_t k = 0; k < 32; ++k) {
+      out[k] &= y[i];
+    }
+    return out ^ one;
+  };
 
+  auto out = factor(0);
   for (std::size_t i = 1; i < 32; ++i) {
-    auto mul = ShareMatrix<mode>::constant(from_uint32(x * (1 << i)));
-    for (std::size_t i = 0; i < 32; ++i) {
-      mul[i] &= y[i];
-    }
+    const auto mul = factor(i);
     MatrixView<const Share<mode>> xx = out;
     MatrixView<const Share<mode>> yy = mul;
     out = naive_integer_multiply(xx, yy);
@@ -187,16 +491,6 @@ ShareMatrix<mode> naive_exponent(std::uint32_t x, const ShareMatrix<mode>& y) {
 }
 
 
-constexpr std::uint32_t pow32(std::uint32_t x, std::uint32_t p) {
-  if (p == 0) return 1;
-  if (p == 1) return x;
-  
-  std::uint32_t tmp = pow32(x, p/2);
-  if (p % 2 == 0) return tmp * tmp;
-  else return x * tmp * tmp;
-}
-
-
 struct ExpTable : public Table {
   ExpTable() { }
   ExpTable(std::uint32_t base, std::size_t shift) : base(base), shift(shift) { }
@@ -255,6 +549,54 @@ ShareMatrix<mode> exponent(std::uint32_t x, const ShareMatrix<mode>& y) {
 }
 
 
+// Like `exponent`, but the chunk lookups are all done up front and their
+// results are combined by a balanced tree of multiplications. The
+// multiplications at each level of the tree are garbled as one batch, so the
+// number of dependent multiplications is logarithmic, rather than linear, in
+// the number of chunks.
+template <Mode mode>
+ShareMatrix<mode> tree_exponent(std::uint32_t x, const ShareMatrix<mode>& y) {
+  const auto n_chunks = (32 + chunking_factor() - 1) / chunking_factor();
+
+  const auto mask = ShareMatrix<mode>::uniform(32, 1);
+  auto masked = integer_sub<mode>(y, mask);
+  masked.reveal();
+
+  auto one = ShareMatrix<mode>(1, 1);
+  one[0] = Share<mode>::bit(true);
+
+  std::vector<ShareMatrix<mode>> level;
+  for (std::size_t i = 0; i < n_chunks; ++i) {
+    const auto chunk_size = std::min(32 - i * chunking_factor(), chunking_factor());
+
+    ShareMatrix<mode> chunk(chunk_size, 1);
+    for (std::size_t j = 0; j < chunk_size; ++j) {
+      chunk[j] = masked[j + i*chunking_factor()];
+    }
+    ExpTable etable { x, i*chunking_factor() };
+    ShareMatrix<mode> pow(32, 1);
+    unary_outer_product<mode>(etable, chunk, one, pow);
+    level.push_back(std::move(pow));
+  }
+
+  // strip off mask by multiplication
+  level.push_back(ShareMatrix<mode>::constant(
+        from_uint32(pow32(x, to_uint32(color<mode>(mask))))));
+
+  while (level.size() > 1) {
+    std::vector<ShareMatrix<mode>> lhs, rhs;
+    for (std::size_t i = 0; i + 1 < level.size(); i += 2) {
+      lhs.push_back(level[i]);
+      rhs.push_back(level[i + 1]);
+    }
+    auto next = integer_multiply_batch<mode>(lhs, rhs);
+    if (level.size() % 2 == 1) { next.push_back(std::move(level.back())); }
+    level = std::move(next);
+  }
+  return level[0];
+}
+
+
 // if s, x, else y
 template <Mode mode>
 ShareMatrix<mode> swap(
@@ -270,9 +612,18 @@ ShareMatrix<mode> swap(
 
   auto diff = x ^ y;
 
+  // the selector is shared by every gate, so they are garbled as one batch
+  std::vector<Share<mode>> d;
   for (std::size_t i = 0; i < n; ++i) {
     for (std::size_t j = 0; j < m; ++j) {
-      diff(i, j) &= s;
+      d.push_back(diff(i, j));
+    }
+  }
+  const std::vector<Share<mode>> sel(n*m, s);
+  and_gates<mode>(d, sel, d);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < m; ++j) {
+      diff(i, j) = d[i*m + j];
     }
   }
 
@@ -283,12 +634,14 @@ ShareMatrix<mode> swap(
 
 template <Mode mode>
 ShareMatrix<mode> sub_if_greater(const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
-  assert(x.rows() == 32 && y.rows() == 32);
+  const auto n = x.rows();
+  assert(y.rows() == n);
   const auto diff = integer_sub<mode>(x, y);
 
-  const auto gt = ((x[31] == y[31]) & (x[31] != diff[31])) | (x[31] & ~y[31]);
+  // x < y exactly when the subtraction borrows out of the top bit.
+  const auto borrow = ((x[n-1] == y[n-1]) & diff[n-1]) | (~x[n-1] & y[n-1]);
 
-  return swap<mode>(gt, x, diff);
+  return swap<mode>(borrow, x, diff);
 }
 
 
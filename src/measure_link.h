@@ -3,24 +3,165 @@
 
 
 #include "link.h"
+#include "share.h"
+
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <string>
+#include <ostream>
+
+
+// What one phase of a run cost. `blocked_seconds` is the time spent inside the
+// underlying link, waiting on the socket; the rest of `seconds` is compute.
+struct PhaseStats {
+  std::size_t bytes_sent = 0;
+  std::size_t bytes_received = 0;
+  std::size_t messages = 0;
+  std::size_t hashes = 0;
+  double seconds = 0;
+  double blocked_seconds = 0;
+
+  PhaseStats& operator+=(const PhaseStats& o) {
+    bytes_sent += o.bytes_sent;
+    bytes_received += o.bytes_received;
+    messages += o.messages;
+    hashes += o.hashes;
+    seconds += o.seconds;
+    blocked_seconds += o.blocked_seconds;
+    return *this;
+  }
+};
+
+
+inline std::ostream& operator<<(std::ostream& os, const PhaseStats& s) {
+  return os
+    << "{\"bytes_sent\": " << s.bytes_sent
+    << ", \"bytes_received\": " << s.bytes_received
+    << ", \"messages\": " << s.messages
+    << ", \"hashes\": " << s.hashes
+    << ", \"seconds\": " << s.seconds
+    << ", \"blocked_seconds\": " << s.blocked_seconds << '}';
+}
+
+
+// Splits the activity of one party into labelled phases. Time and hashes go to
+// the innermost open phase only, so the phases of a run add up to its total.
+class PhaseRecorder {
+public:
+  PhaseRecorder(Mode mode) : mode(mode), last(clock::now()), last_hashes(total_hashes(mode)) { }
+  virtual ~PhaseRecorder() { }
+
+  const char* phase() const { return current; }
+
+  // Charges the time and hashes since the last switch to the current phase
+  // and makes `label` current.
+  void enter(const char* label) {
+    const auto now = clock::now();
+    const auto hashes = total_hashes(mode);
+    auto& s = stats();
+    s.seconds += std::chrono::duration<double>(now - last).count();
+    s.hashes += hashes - last_hashes;
+    last = now;
+    last_hashes = hashes;
+    current = label;
+  }
+
+  PhaseStats& stats() { return phases[current]; }
+
+  const std::map<std::string, PhaseStats>& all_phases() {
+    enter(current);
+    return phases;
+  }
+
+  PhaseStats total() {
+    PhaseStats out;
+    for (const auto& [_, s]: all_phases()) { out += s; }
+    return out;
+  }
+
+  void reset_phases() {
+    enter(current);
+    phases.clear();
+  }
+
+  // {"total": {...}, "phases": {"<label>": {...}, ...}}
+  void write_json(std::ostream& os) {
+    os << "{\"total\": " << total() << ", \"phases\": {";
+    bool first = true;
+    for (const auto& [label, s]: all_phases()) {
+      os << (first ? "" : ", ") << '"' << label << "\": " << s;
+      first = false;
+    }
+    os << "}}";
+  }
+
+protected:
+  using clock = std::chrono::steady_clock;
+
+  template <typename F>
+  void blocked(F f) {
+    const auto start = clock::now();
+    f();
+    stats().blocked_seconds += std::chrono::duration<double>(clock::now() - start).count();
+  }
+
+private:
+  Mode mode;
+  const char* current = "other";
+  clock::time_point last;
+  std::size_t last_hashes;
+  std::map<std::string, PhaseStats> phases;
+};
+
+
+// Labels the work of this thread until the end of the scope. Phases nest; the
+// previous label is restored on exit. Without a recorder on this thread's link,
+// or inside a phase of the same label (e.g. single AND gates within a ripple
+// adder), this does nothing.
+class Phase {
+public:
+  explicit Phase(const char* label) : recorder(dynamic_cast<PhaseRecorder*>(*the_link())) {
+    if (recorder && std::strcmp(recorder->phase(), label) == 0) { recorder = nullptr; }
+    if (recorder) {
+      previous = recorder->phase();
+      recorder->enter(label);
+    }
+  }
+
+  ~Phase() {
+    if (recorder) { recorder->enter(previous); }
+  }
+
+  Phase(const Phase&) = delete;
+  Phase& operator=(const Phase&) = delete;
+
+private:
+  PhaseRecorder* recorder;
+  const char* previous = nullptr;
+};
+
 
 template <typename L>
-struct MeasureLink : public Link {
+struct MeasureLink : public Link, public PhaseRecorder {
 public:
-  MeasureLink();
-  MeasureLink(L* under) : under(under) { }
+  MeasureLink(L* under, Mode mode = Mode::G) : PhaseRecorder(mode), under(under) { }
 
   void send(std::span<const std::byte> s) {
     n += s.size();
-    under->send(s);
+    stats().bytes_sent += s.size();
+    ++stats().messages;
+    blocked([&] { under->send(s); });
   }
   void recv(std::span<std::byte> s) {
     n += s.size();
-    under->recv(s);
+    stats().bytes_received += s.size();
+    ++stats().messages;
+    blocked([&] { under->recv(s); });
   }
 
   void flush() {
-    under->flush();
+    blocked([&] { under->flush(); });
   }
 
   std::size_t count() const { return n; }
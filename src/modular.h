@@ -0,0 +1,365 @@
+#ifndef MODULAR_H__
+#define MODULAR_H__
+
+
+#include "integer.h"
+#include "unary_outer_product.h"
+
+#include <bit>
+#include <vector>
+
+
+// The cost of sending one ciphertext, measured in hash (AES) calls.
+// Used to trade computation against communication when planning reductions.
+inline std::size_t& ciphertext_cost() {
+  static std::size_t cost = 16;
+  return cost;
+}
+
+
+// Row i is i * 2^shift mod p.
+struct ModTable : public Table {
+  ModTable() { }
+  ModTable(std::uint64_t p, std::size_t shift) : p(p) {
+    unsigned __int128 pow = 1;
+    for (std::size_t i = 0; i < shift; ++i) { pow = (pow * 2) % p; }
+    scale = pow;
+  }
+
+  std::size_t operator()(std::size_t i) const {
+    return (static_cast<unsigned __int128>(i) * scale) % p;
+  }
+
+  std::uint64_t p;
+  std::uint64_t scale;
+};
+
+
+// A plan for reducing n-bit integers modulo a public p.
+//
+// The input x is masked by a uniform r and revealed, so that E knows
+// x - r mod 2^n. The low bits of the masked value are used as is, and each
+// higher chunk is mapped to chunk * 2^offset mod p by a one-hot lookup.
+// Adding r mod p and correcting for the wrap of the masked subtraction gives
+// a sum that is congruent to x, and a few conditional subtractions bring it
+// into [0, p).
+struct ModularReduction {
+  ModularReduction() { }
+  ModularReduction(std::uint64_t p, std::size_t n) : p(p), n(n) {
+    assert(p > 1 && std::bit_width(p) < 63);
+    low = std::bit_width(p) - 1;
+
+    chunk = 1;
+    double best = cost(1);
+    for (std::size_t c = 2; c <= std::min<std::size_t>(high_bits(), 16); ++c) {
+      if (cost(c) < best) {
+        best = cost(c);
+        chunk = c;
+      }
+    }
+  }
+
+  std::size_t out_bits() const { return std::bit_width(p); }
+  std::size_t high_bits() const { return n > low ? n - low : 0; }
+  std::size_t n_chunks(std::size_t c) const { return (high_bits() + c - 1) / c; }
+  std::size_t n_chunks() const { return n_chunks(chunk); }
+
+  // The sum is a total of n_chunks + 3 terms, each less than p: the low bits,
+  // the chunk lookups, r mod p, and the wrap correction. One extra bit keeps
+  // the sign bit of the conditional subtractions clear.
+  std::size_t sum_bits(std::size_t c) const {
+    return std::bit_width(p) + std::bit_width(n_chunks(c) + 3) + 1;
+  }
+  std::size_t sum_bits() const { return sum_bits(chunk); }
+
+  // Removes 2^i p for i = rounds-1, ..., 0; the quotient is at most n_chunks + 2.
+  std::size_t rounds(std::size_t c) const { return std::bit_width(n_chunks(c) + 2); }
+  std::size_t rounds() const { return rounds(chunk); }
+
+  // Estimated cost in hash calls. An AND gate costs two ciphertexts and four
+  // hashes; each chunk needs a seed tree, its leaves, one message and an adder;
+  // each round needs a subtraction and a multiplexer.
+  double cost(std::size_t c) const {
+    const double ct = ciphertext_cost();
+    const double and_gate = 2*ct + 4;
+    const double w = sum_bits(c);
+    const double per_chunk = (1 << c) + 2*(c - 1)*(ct + 2) + ct + w*and_gate;
+    return n_chunks(c)*per_chunk + rounds(c)*2*w*and_gate;
+  }
+
+  std::uint64_t p;
+  std::size_t n;
+  std::size_t low;
+  std::size_t chunk;
+};
+
+
+// Computes x mod p, as a vector of bit_width(p) shares.
+template <Mode mode>
+ShareMatrix<mode> mod_reduce(const ModularReduction& plan, const ShareMatrix<mode>& x) {
+  const auto n = plan.n;
+  const auto p = plan.p;
+  const auto w = plan.sum_bits();
+  assert(x.rows() == n);
+
+  if (plan.high_bits() == 0) {
+    return integer_slice<mode>(x, 0, n, plan.out_bits());
+  }
+
+  auto one = ShareMatrix<mode>(1, 1);
+  one[0] = Share<mode>::bit(true);
+
+  // masked = x - r mod 2^n, and borrow is set when the subtraction wraps,
+  // i.e. x = masked + r - borrow * 2^n.
+  const auto mask = ShareMatrix<mode>::uniform(n, 1);
+  auto masked = ShareMatrix<mode>::vector(n);
+  auto borrow = Share<mode>::bit(false);
+  for (std::size_t i = 0; i < n; ++i) { masked[i] = subtract_bit<mode>(x[i], mask[i], borrow); }
+  masked.reveal();
+
+  auto sum = integer_slice<mode>(masked, 0, plan.low, w);
+
+  for (std::size_t offset = plan.low; offset < n; offset += plan.chunk) {
+    const auto chunk_size = std::min(plan.chunk, n - offset);
+    const auto chunk = integer_slice<mode>(masked, offset, chunk_size, chunk_size);
+
+    ModTable table { p, offset };
+    ShareMatrix<mode> reduced(plan.out_bits(), 1);
+    unary_outer_product<mode>(table, chunk, one, reduced);
+    sum = integer_add<mode>(sum, integer_slice<mode>(reduced, 0, plan.out_bits(), w));
+  }
+
+  // r mod p is known to G, and -2^n = p - (2^n mod p) (mod p) is public, so
+  // both corrections are free to construct.
+  std::uint64_t r_mod_p = 0;
+  if constexpr (mode == Mode::G) {
+    for (std::size_t i = n; i-- > 0;) {
+      r_mod_p = (static_cast<unsigned __int128>(r_mod_p) * 2 + mask[i].color()) % p;
+    }
+  }
+  sum = integer_add<mode>(sum,
+      ShareMatrix<mode>::constant(from_limbs({ r_mod_p }, w)));
+
+  const auto wrap = from_limbs({ p - ModTable { p, n }(1) }, w);
+  auto correction = ShareMatrix<mode>::vector(w);
+  for (std::size_t i = 0; i < w; ++i) {
+    if (wrap[i]) { correction[i] = borrow; }
+  }
+  sum = integer_add<mode>(sum, correction);
+
+  for (std::size_t j = plan.rounds(); j-- > 0;) {
+    const auto pj = static_cast<unsigned __int128>(p) << j;
+    const auto pj_bits = ShareMatrix<mode>::constant(
+        from_limbs({ static_cast<std::uint64_t>(pj), static_cast<std::uint64_t>(pj >> 64) }, w));
+    sum = sub_if_greater<mode>(sum, pj_bits);
+  }
+
+  return integer_slice<mode>(sum, 0, plan.out_bits(), plan.out_bits());
+}
+
+
+// Computes x + y mod p for x, y in [0, p).
+template <Mode mode>
+ShareMatrix<mode> mod_add(std::uint64_t p, const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
+  const std::size_t b = std::bit_width(p);
+  assert(x.rows() == b);
+  assert(y.rows() == b);
+
+  // two extra bits: one for the carry, one for the sign of the subtraction
+  auto sum = integer_add<mode>(integer_slice<mode>(x, 0, b, b + 2), integer_slice<mode>(y, 0, b, b + 2));
+  sum = sub_if_greater<mode>(sum, ShareMatrix<mode>::constant(from_limbs({ p }, b + 2)));
+  return integer_slice<mode>(sum, 0, b, b);
+}
+
+
+// Computes x * y mod p for any x, y of bit_width(p) bits; the product is
+// reduced in full, so neither needs to be reduced.
+template <Mode mode>
+ShareMatrix<mode> mod_mul(std::uint64_t p, const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
+  const std::size_t b = std::bit_width(p);
+  assert(x.rows() == b);
+  assert(y.rows() == b);
+
+  static thread_local ModularReduction plan;
+  if (plan.p != p || plan.n != 2*b) { plan = { p, 2*b }; }
+
+  return mod_reduce<mode>(plan, karatsuba_multiply<mode>(x, y));
+}
+
+
+// Row z is (z mod p)^-1 mod p for a prime p; 0 maps to 0. The workers read
+// the table once per leaf and column, so all 2^b rows are computed up front,
+// with the recurrence z^-1 = -(p / z) (p mod z)^-1.
+struct ModInverseTable : public Table {
+  ModInverseTable() { }
+  ModInverseTable(std::uint64_t p) : p(p), rows(std::size_t { 1 } << std::bit_width(p)) {
+    if (p > 1) { rows[1] = 1; }
+    for (std::uint64_t z = 2; z < p; ++z) {
+      rows[z] = (p - (p / z) * rows[p % z] % p) % p;
+    }
+    for (std::size_t z = p; z < rows.size(); ++z) { rows[z] = rows[z - p]; }
+  }
+
+  std::size_t operator()(std::size_t z) const {
+    return rows[z];
+  }
+
+  std::uint64_t p = 0;
+  std::vector<std::uint64_t> rows;
+};
+
+
+// Moduli up to this many bits are inverted with a one-hot product over all
+// residues; larger ones use Fermat's little theorem.
+constexpr std::size_t max_one_hot_inverse_bits = 16;
+
+
+// Computes x^-1 mod p for a prime p and x in [1, p).
+//
+// For small p, G draws a uniform y in [1, p) and x y mod p is revealed; it is
+// uniform, so it says nothing about x. A one-hot product of the table of
+// inverses at x y with the bits of y gives the partial products of
+// (x y)^-1 y = x^-1, and a modular reduction finishes. Larger moduli compute
+// x^(p-2) by square-and-multiply over the public exponent.
+template <Mode mode>
+ShareMatrix<mode> mod_inverse(std::uint64_t p, const ShareMatrix<mode>& x) {
+  const std::size_t b = std::bit_width(p);
+  assert(x.rows() == b);
+
+  if (b <= max_one_hot_inverse_bits) {
+    auto y = ShareMatrix<mode>::vector(b);
+    if constexpr (mode == Mode::G) {
+      std::uint64_t v = 0;
+      while (v == 0 || v >= p) {
+        y = ShareMatrix<mode>::uniform(b, 1);
+        v = to_limbs(color<mode>(y))[0];
+      }
+    }
+
+    auto xy = mod_mul<mode>(p, x, y);
+    xy.reveal();
+
+    static thread_local ModInverseTable inv;
+    if (inv.p != p) { inv = { p }; }
+    ShareMatrix<mode> outer(b, b);
+    unary_outer_product<mode>(inv, xy, y, outer);
+
+    std::vector<std::vector<Share<mode>>> columns(2*b);
+    for (std::size_t i = 0; i < b; ++i) {
+      for (std::size_t j = 0; j < b; ++j) {
+        columns[i + j].push_back(outer(i, j));
+      }
+    }
+    static thread_local ModularReduction plan;
+    if (plan.p != p || plan.n != 2*b) { plan = { p, 2*b }; }
+    return mod_reduce<mode>(plan, sum_columns<mode>(std::move(columns)));
+  }
+
+  auto out = ShareMatrix<mode>::constant(from_limbs({ 1 }, b));
+  for (std::size_t i = std::bit_width(p - 2); i-- > 0;) {
+    out = mod_mul<mode>(p, out, out);
+    if (((p - 2) >> i) & 1) { out = mod_mul<mode>(p, out, x); }
+  }
+  return out;
+}
+
+
+// Selects table[i] for a secret index i.
+// A one-hot lookup turns i into the secret unary vector U(i), and then every
+// entry is masked by its bit of U(i) in a single batch of AND gates. Unlike a
+// tree of multiplexers, the whole selection takes one round trip.
+template <Mode mode>
+ShareMatrix<mode> select(
+    const std::vector<ShareMatrix<mode>>& table, const ShareMatrix<mode>& index) {
+  const auto n = index.rows();
+  assert(n <= 6);
+  assert(table.size() == (std::size_t { 1 } << n));
+  const auto b = table[0].rows();
+
+  UnaryTable unary;
+  const auto hot = lookup<mode>(unary, 1 << n, index);
+
+  std::vector<Share<mode>> sel;
+  std::vector<Share<mode>> entries;
+  for (std::size_t i = 0; i < table.size(); ++i) {
+    for (std::size_t k = 0; k < b; ++k) {
+      sel.push_back(hot[i]);
+      entries.push_back(table[i][k]);
+    }
+  }
+  std::vector<Share<mode>> masked(sel.size());
+  and_gates<mode>(sel, entries, masked);
+
+  auto out = ShareMatrix<mode>::vector(b);
+  for (std::size_t i = 0; i < table.size(); ++i) {
+    for (std::size_t k = 0; k < b; ++k) {
+      out[k] ^= masked[i*b + k];
+    }
+  }
+  return out;
+}
+
+
+// Picks the window width for a t-bit exponent modulo a b-bit p. Counted in
+// AND gates, a modular multiplication costs about b^2 and selecting from 2^w
+// powers costs 2^w (b + 1). The t squarings do not depend on w.
+inline std::size_t mod_exp_window(std::size_t b, std::size_t t) {
+  std::size_t best = 1;
+  double best_cost = 0;
+  for (std::size_t w = 1; w <= std::min<std::size_t>(t, 6); ++w) {
+    const double windows = (t + w - 1) / w;
+    const double mul = b*b;
+    const double cost =
+      ((1 << w) - 2)*mul + (windows - 1)*mul + windows*(1 << w)*(b + 1);
+    if (w == 1 || cost < best_cost) {
+      best = w;
+      best_cost = cost;
+    }
+  }
+  return best;
+}
+
+
+// Computes x^e mod p for a secret base x in [0, p) and a secret exponent e.
+// The powers x^0, ..., x^(2^w - 1) are computed once; the exponent is then
+// consumed w bits at a time from the top, with w squarings and one
+// multiplication by the selected power per window.
+template <Mode mode>
+ShareMatrix<mode> mod_exp(
+    std::uint64_t p, const ShareMatrix<mode>& x, const ShareMatrix<mode>& e, std::size_t w) {
+  const std::size_t b = std::bit_width(p);
+  const auto t = e.rows();
+  assert(x.rows() == b);
+  assert(w >= 1 && w <= 6);
+
+  std::vector<ShareMatrix<mode>> powers(1 << w);
+  powers[0] = ShareMatrix<mode>::constant(from_limbs({ 1 }, b));
+  powers[1] = x;
+  for (std::size_t i = 2; i < powers.size(); ++i) {
+    powers[i] = mod_mul<mode>(p, powers[i/2], powers[i - i/2]);
+  }
+
+  const auto window = [&](std::size_t start) {
+    const auto size = std::min(w, t - start);
+    const auto bits = integer_slice<mode>(e, start, size, size);
+    const std::vector<ShareMatrix<mode>> candidates(powers.begin(), powers.begin() + (1 << size));
+    return select<mode>(candidates, bits);
+  };
+
+  const auto n_windows = (t + w - 1) / w;
+  auto out = window((n_windows - 1) * w);
+  for (std::size_t i = n_windows - 1; i-- > 0;) {
+    for (std::size_t j = 0; j < w; ++j) { out = mod_mul<mode>(p, out, out); }
+    out = mod_mul<mode>(p, out, window(i * w));
+  }
+  return out;
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> mod_exp(std::uint64_t p, const ShareMatrix<mode>& x, const ShareMatrix<mode>& e) {
+  return mod_exp<mode>(p, x, e, mod_exp_window(std::bit_width(p), e.rows()));
+}
+
+
+#endif
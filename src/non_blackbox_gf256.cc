@@ -125,7 +125,7 @@ ShareMatrix<mode> aes_sbox(const ShareMatrix<mode>& x) {
 
   auto zero = ~x[0];
   for (std::size_t i = 1; i < 8; ++i) {
-    zero &= x[i];
+    zero &= ~x[i];
   }
   auto z = ShareMatrix<mode>::vector(8);
   z[0] = zero;
@@ -0,0 +1,16 @@
+#ifndef SBOX_H__
+#define SBOX_H__
+
+
+#include "table.h"
+
+
+// Public S-box tables for use with `lookup`.
+extern const ExplicitTable present_sbox_table; // PRESENT, 4 bits to 4 bits
+extern const ExplicitTable skinny64_sbox_table; // SKINNY-64, 4 bits to 4 bits
+extern const ExplicitTable skinny128_sbox_table; // SKINNY-128, 8 bits to 8 bits
+extern const ExplicitTable sm4_sbox_table; // SM4, 8 bits to 8 bits
+extern const ExplicitTable camellia_sbox_table; // Camellia (s1), 8 bits to 8 bits
+
+
+#endif
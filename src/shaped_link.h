@@ -0,0 +1,123 @@
+#ifndef SHAPED_LINK_H__
+#define SHAPED_LINK_H__
+
+
+#include "link.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+// The network that a ShapedLink imitates, one direction at a time.
+struct NetworkShape {
+  double bandwidth = 0; // bytes per second; 0 is unlimited
+  double rtt = 0; // seconds
+  double jitter = 0; // seconds; each message is delayed by up to this much more
+  std::size_t burst = 1 << 16; // bytes that may leave at once after an idle period
+  std::uint64_t seed = 0; // for the jitter
+
+  bool shaped() const { return bandwidth > 0 || rtt > 0 || jitter > 0; }
+
+  static NetworkShape mbps(double megabits, double rtt_ms, double jitter_ms = 0) {
+    return { megabits * 1e6 / 8, rtt_ms / 1e3, jitter_ms / 1e3 };
+  }
+
+  static NetworkShape lan() { return mbps(1000, 0.2); }
+  // The setting in network.sh.
+  static NetworkShape wan() { return mbps(100, 10); }
+};
+
+
+// Wraps a link so that its traffic behaves as if it crossed the given network.
+// The sender runs a token bucket: a message leaves once the bucket holds
+// enough tokens, which refill at the bandwidth, and arrives half an RTT (plus
+// jitter) later. The arrival time travels with the message, and the receiver
+// waits until then before handing it out. Messages never overtake each other,
+// and the sender never blocks, as if its socket buffer were unbounded.
+//
+// Both parties must wrap their ends with the same shape. Arrival times are
+// read from the steady clock, which is shared by every process on a host.
+template <typename L>
+struct ShapedLink : public Link {
+public:
+  ShapedLink(L* under, const NetworkShape& shape)
+    : under(under), shape(shape), rng(shape.seed), tokens(shape.burst), refilled(clock::now()) { }
+
+  void send(std::span<const std::byte> s) {
+    if (!shape.shaped()) { under->send(s); return; }
+
+    const auto now = clock::now();
+    auto depart = now;
+    if (shape.bandwidth > 0) {
+      tokens = std::min<double>(shape.burst, tokens + seconds(now - refilled) * shape.bandwidth);
+      refilled = now;
+      tokens -= s.size();
+      if (tokens < 0) { depart += duration(-tokens / shape.bandwidth); }
+    }
+
+    std::uniform_real_distribution<double> jitter(0, shape.jitter);
+    auto arrival = depart + duration(shape.rtt / 2 + (shape.jitter > 0 ? jitter(rng) : 0));
+    arrival = std::max(arrival, last_arrival);
+    last_arrival = arrival;
+
+    const std::int64_t header[2] = {
+      arrival.time_since_epoch().count(), static_cast<std::int64_t>(s.size())
+    };
+    under->send({ reinterpret_cast<const std::byte*>(header), sizeof(header) });
+    under->send(s);
+  }
+
+  void recv(std::span<std::byte> s) {
+    if (!shape.shaped()) { under->recv(s); return; }
+
+    while (!s.empty()) {
+      if (pos == frame.size()) { next_frame(); }
+      const auto n = std::min(s.size(), frame.size() - pos);
+      std::memcpy(s.data(), frame.data() + pos, n);
+      pos += n;
+      s = s.subspan(n);
+    }
+  }
+
+  void flush() {
+    under->flush();
+  }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  static double seconds(clock::duration d) { return std::chrono::duration<double>(d).count(); }
+  static clock::duration duration(double s) {
+    return std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(s));
+  }
+
+  void next_frame() {
+    std::int64_t header[2];
+    under->recv({ reinterpret_cast<std::byte*>(header), sizeof(header) });
+    frame.resize(header[1]);
+    pos = 0;
+    under->recv(frame);
+    std::this_thread::sleep_until(clock::time_point { clock::duration { header[0] } });
+  }
+
+  L* under;
+  NetworkShape shape;
+  std::mt19937_64 rng;
+
+  // sender
+  double tokens;
+  clock::time_point refilled;
+  clock::time_point last_arrival;
+
+  // receiver
+  std::vector<std::byte> frame;
+  std::size_t pos = 0;
+};
+
+
+#endif
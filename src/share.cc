@@ -1,8 +1,15 @@
 #include "share.h"
 #include "prg.h"
 #include "link.h"
+#include "measure_link.h"
+
+#include <immintrin.h>
 
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <cassert>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 
@@ -11,10 +18,14 @@ std::bitset<128> delta;
 
 PRG prg;
 
+// Counted on G's thread only, so G and E may run in one process.
+thread_local std::size_t ciphertexts = 0;
+
 
 template<> void Share<Mode::G>::initialize(std::bitset<128> fixed_key, std::bitset<128> seed) {
   Share<Mode::G>::nonce = 0;
   Share<Mode::G>::fixed_key = fixed_key;
+  ciphertexts = 0;
   prg = seed;
   delta = prg();
   delta[0] = 1;
@@ -42,50 +53,251 @@ template<> Share<Mode::G> Share<Mode::G>::bit(bool b) {
 
 
 
-thread_local Link* link;
+thread_local Link* thread_link;
+
+Link** the_link() { return &thread_link; }
 
-Link** the_link() { return &link; }
 
+// Counters are never freed, so that the hashes of finished threads still count.
+std::mutex hash_counters_mutex;
+std::vector<std::unique_ptr<std::atomic<std::size_t>>> hash_counters[2];
+
+std::atomic<std::size_t>& register_hash_counter(Mode mode) {
+  std::lock_guard lock { hash_counters_mutex };
+  auto& counters = hash_counters[static_cast<int>(mode)];
+  counters.push_back(std::make_unique<std::atomic<std::size_t>>(0));
+  return *counters.back();
+}
 
-std::size_t ptr = 0;
-std::vector<std::bitset<128>> messages;
+std::size_t total_hashes(Mode mode) {
+  std::lock_guard lock { hash_counters_mutex };
+  std::size_t out = 0;
+  for (const auto& c: hash_counters[static_cast<int>(mode)]) {
+    out += c->load(std::memory_order_relaxed);
+  }
+  return out;
+}
 
 
 std::size_t n_ciphertexts() {
-  return 0;
-  /* return messages.size(); */
+  return ciphertexts;
+}
+
+
+void count_ciphertexts(std::size_t n) {
+  ciphertexts += n;
 }
 
 
 template<> void Share<Mode::G>::send() const {
   static std::array<std::byte, 16> buffer;
   memcpy(buffer.data(), &val, 16);
-  link->send(buffer);
-  /* messages.push_back(val); */
+  thread_link->send(buffer);
+  ++ciphertexts;
 }
 
 
 template<> Share<Mode::E> Share<Mode::E>::recv() {
   static std::array<std::byte, 16> buffer;
-  link->recv(buffer);
+  thread_link->recv(buffer);
   Share<Mode::E> out;
   memcpy(&out.val, buffer.data(), 16);
   return out;
-  /* return messages[ptr++]; */
 }
 
 
-std::size_t reveal_ptr = 0;
-std::vector<bool> revelations;
+// Packs the colors of xs eight to a byte into bits, which start out zero. With
+// AVX2, each vector holds two labels: bit 0 of a label is the low bit of its
+// first byte.
+template <Mode mode>
+void pack_colors(std::span<const Share<mode>> xs, std::span<std::uint8_t> bits) {
+  const auto n = xs.size();
+  std::size_t i = 0;
+#ifdef __AVX2__
+  const auto* labels = reinterpret_cast<const std::byte*>(xs.data());
+  for (; i + 8 <= n; i += 8) {
+    std::uint8_t byte = 0;
+    for (std::size_t k = 0; k < 4; ++k) {
+      const auto* p = reinterpret_cast<const __m256i*>(labels + 16*(i + 2*k));
+      const std::uint32_t m = _mm256_movemask_epi8(_mm256_slli_epi64(_mm256_loadu_si256(p), 7));
+      byte |= ((m & 1) | ((m >> 15) & 2)) << (2*k);
+    }
+    bits[i/8] = byte;
+  }
+#endif
+  for (; i < n; ++i) {
+    bits[i/8] |= xs[i].color() << (i%8);
+  }
+}
+
+
+// The low 64 bits of a label.
+std::uint64_t tag(const std::bitset<128>& x) {
+  std::uint64_t out;
+  memcpy(&out, &x, 8);
+  return out;
+}
+
+
+// G sends its colors and clears them. E adds each bit into its own color,
+// which then holds the revealed value.
+template<> void reveal(std::span<Share<Mode::G>> xs) {
+  const auto n = xs.size();
+  if (n == 0) { return; }
+  Phase phase { "reveal" };
+
+  std::vector<std::uint8_t> bits((n + 7) / 8);
+  pack_colors<Mode::G>(xs, bits);
+  for (auto& x: xs) { (*x)[0] = 0; }
+  thread_link->send(std::as_bytes(std::span { bits }));
+}
+
+
+template<> void reveal(std::span<Share<Mode::E>> xs) {
+  const auto n = xs.size();
+  if (n == 0) { return; }
+  Phase phase { "reveal" };
+
+  std::vector<std::uint8_t> bits((n + 7) / 8);
+  thread_link->recv(std::as_writable_bytes(std::span { bits }));
+
+  std::size_t i = 0;
+#ifdef __AVX2__
+  // Broadcasting a byte and masking it with selector k leaves bit 2k in the
+  // first label's low byte and bit 2k + 1 in the second's; min(., 1) turns
+  // those into the flips.
+  auto* labels = reinterpret_cast<std::byte*>(xs.data());
+  const auto one = _mm256_set1_epi8(1);
+  for (; i + 8 <= n; i += 8) {
+    const auto byte = _mm256_set1_epi8(bits[i/8]);
+    for (std::size_t k = 0; k < 4; ++k) {
+      const auto selector = _mm256_set_epi64x(0, 2 << (2*k), 0, 1 << (2*k));
+      const auto flips = _mm256_min_epu8(_mm256_and_si256(byte, selector), one);
+      auto* p = reinterpret_cast<__m256i*>(labels + 16*(i + 2*k));
+      _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), flips));
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    (*xs[i])[0] = (*xs[i])[0] ^ ((bits[i/8] >> (i%8)) & 1);
+  }
+}
+
+
+// Both parties hash with the nonces of the batch, whether or not E's labels
+// turn out to be valid, so that the nonces stay in step.
+template<> std::vector<std::uint8_t> decode_to_evaluator(
+    std::span<const Share<Mode::G>> xs, bool check) {
+  const auto n = xs.size();
+  if (n == 0) { return { }; }
+  Phase phase { "output" };
+
+  std::vector<std::uint8_t> bits((n + 7) / 8);
+  pack_colors<Mode::G>(xs, bits);
+  thread_link->send(std::as_bytes(std::span { bits }));
+
+  if (check) {
+    const auto one = Share<Mode::G>::bit(1);
+    std::vector<std::uint64_t> tags(2 * n);
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto nonce = Share<Mode::G>::nonce + i;
+      const auto c = xs[i].color();
+      tags[2*i + c] = tag(*xs[i].H(nonce));
+      tags[2*i + !c] = tag(*(xs[i] ^ one).H(nonce));
+    }
+    Share<Mode::G>::nonce += n;
+    thread_link->send(std::as_bytes(std::span { tags }));
+    ciphertexts += n;
+  }
+  return { };
+}
+
+
+template<> std::vector<std::uint8_t> decode_to_evaluator(
+    std::span<const Share<Mode::E>> xs, bool check) {
+  const auto n = xs.size();
+  if (n == 0) { return { }; }
+  Phase phase { "output" };
+
+  std::vector<std::uint8_t> bits((n + 7) / 8);
+  thread_link->recv(std::as_writable_bytes(std::span { bits }));
+  std::vector<std::uint8_t> colors((n + 7) / 8);
+  pack_colors<Mode::E>(xs, colors);
+  for (std::size_t j = 0; j < bits.size(); ++j) { bits[j] ^= colors[j]; }
+
+  if (check) {
+    std::vector<std::uint64_t> tags(2 * n);
+    thread_link->recv(std::as_writable_bytes(std::span { tags }));
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto nonce = Share<Mode::E>::nonce + i;
+      if (tag(*xs[i].H(nonce)) != tags[2*i + xs[i].color()]) {
+        std::cerr << "ERROR: BAD LABEL on output wire " << i << '\n';
+        std::exit(1);
+      }
+    }
+    Share<Mode::E>::nonce += n;
+  }
+  return bits;
+}
+
+
+template<> std::vector<std::uint8_t> decode_to_garbler(
+    std::span<const Share<Mode::G>> xs, bool check) {
+  const auto n = xs.size();
+  if (n == 0) { return { }; }
+  Phase phase { "output" };
+
+  std::vector<std::uint8_t> bits((n + 7) / 8);
+  thread_link->recv(std::as_writable_bytes(std::span { bits }));
+  std::vector<std::uint8_t> colors((n + 7) / 8);
+  pack_colors<Mode::G>(xs, colors);
+  for (std::size_t j = 0; j < bits.size(); ++j) { bits[j] ^= colors[j]; }
+
+  if (check) {
+    Share<Mode::G> digest;
+    thread_link->recv(std::as_writable_bytes(std::span { &(*digest), 1 }));
+    const auto one = Share<Mode::G>::bit(1);
+    const auto zero = Share<Mode::G>::bit(0);
+    Share<Mode::G> expected;
+    for (std::size_t i = 0; i < n; ++i) {
+      const bool v = (bits[i/8] >> (i%8)) & 1;
+      expected ^= (xs[i] ^ (v ? one : zero)).H(Share<Mode::G>::nonce + i);
+    }
+    Share<Mode::G>::nonce += n;
+    if (*digest != *expected) {
+      std::cerr << "ERROR: BAD LABEL among " << n << " output wires\n";
+      std::exit(1);
+    }
+  }
+  return bits;
+}
+
+
+template<> std::vector<std::uint8_t> decode_to_garbler(
+    std::span<const Share<Mode::E>> xs, bool check) {
+  const auto n = xs.size();
+  if (n == 0) { return { }; }
+  Phase phase { "output" };
+
+  std::vector<std::uint8_t> bits((n + 7) / 8);
+  pack_colors<Mode::E>(xs, bits);
+  thread_link->send(std::as_bytes(std::span { bits }));
+
+  if (check) {
+    Share<Mode::E> digest;
+    for (std::size_t i = 0; i < n; ++i) {
+      digest ^= xs[i].H(Share<Mode::E>::nonce + i);
+    }
+    Share<Mode::E>::nonce += n;
+    thread_link->send(std::as_bytes(std::span { &(*digest), 1 }));
+  }
+  return { };
+}
+
 
 template<Mode mode>
 void Share<mode>::reveal() {
-  if constexpr (mode == Mode::G) {
-    revelations.push_back(color());
-    val[0] = 0;
-  } else {
-    val[0] = val[0] ^ revelations[reveal_ptr++];
-  }
+  ::reveal<mode>(std::span { this, 1 });
 }
 
 template void Share<Mode::G>::reveal();
@@ -116,6 +328,7 @@ template<> Share<Mode::E> Share<Mode::E>::uniform() {
 }
 
 template<> Share<Mode::E>& Share<Mode::E>::operator&=(const Share<Mode::E>& o) {
+  Phase phase { "and gates" };
   const auto A = *this;
   const auto B = o;
 
@@ -139,6 +352,7 @@ template<> Share<Mode::E>& Share<Mode::E>::operator&=(const Share<Mode::E>& o) {
 }
 
 template<> Share<Mode::G>& Share<Mode::G>::operator&=(const Share<Mode::G>& o) {
+  Phase phase { "and gates" };
   const auto A = *this;
   const auto B = o;
 
@@ -165,6 +379,85 @@ template<> Share<Mode::G>& Share<Mode::G>::operator&=(const Share<Mode::G>& o) {
 }
 
 
+// These follow operator&= gate by gate, but use explicit nonces so that the
+// rows of the whole batch can be buffered.
+template<> void and_gates(
+    std::span<const Share<Mode::G>> x,
+    std::span<const Share<Mode::G>> y,
+    std::span<Share<Mode::G>> out) {
+  assert(x.size() == y.size());
+  assert(out.size() == x.size());
+  Phase phase { "and gates" };
+
+  const auto zero = Share<Mode::G>::bit(0);
+  const auto one = Share<Mode::G>::bit(1);
+
+  std::vector<std::byte> buffer(32 * x.size());
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    const auto A = x[i];
+    const auto B = y[i];
+
+    const auto a = A.color();
+    const auto b = B.color();
+
+    const auto nonce = Share<Mode::G>::nonce + 2*i;
+
+    // E gate
+    const auto X = (A ^ (a ? one : zero)).H(nonce);
+    const auto e_row = (A ^ (a ? zero : one)).H(nonce) ^ X ^ B;
+
+    // G gate
+    const auto Y = (B ^ (b ? one : zero)).H(nonce + 1) ^ ((a && b) ? one : zero);
+    const auto g_row = (B ^ (b ? zero : one)).H(nonce + 1) ^ Y ^ ((a && !b) ? one : zero);
+
+    memcpy(buffer.data() + 32*i, &(*e_row), 16);
+    memcpy(buffer.data() + 32*i + 16, &(*g_row), 16);
+    out[i] = X ^ Y;
+  }
+  Share<Mode::G>::nonce += 2 * x.size();
+  thread_link->send(buffer);
+  ciphertexts += 2 * x.size();
+}
+
+
+template<> void and_gates(
+    std::span<const Share<Mode::E>> x,
+    std::span<const Share<Mode::E>> y,
+    std::span<Share<Mode::E>> out) {
+  assert(x.size() == y.size());
+  assert(out.size() == x.size());
+  Phase phase { "and gates" };
+
+  const auto zero = Share<Mode::E>::bit(0);
+
+  std::vector<std::byte> buffer(32 * x.size());
+  thread_link->recv(buffer);
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    const auto A = x[i];
+    const auto B = y[i];
+
+    const auto a = A.color();
+    const auto b = B.color();
+
+    const auto nonce = Share<Mode::E>::nonce + 2*i;
+
+    Share<Mode::E> e_row;
+    Share<Mode::E> g_row;
+    memcpy(&(*e_row), buffer.data() + 32*i, 16);
+    memcpy(&(*g_row), buffer.data() + 32*i + 16, 16);
+
+    // E gate
+    const auto X = A.H(nonce) ^ (a ? (e_row ^ B) : zero);
+
+    // G gate
+    const auto Y = B.H(nonce + 1) ^ (b ? g_row : zero);
+
+    out[i] = X ^ Y;
+  }
+  Share<Mode::E>::nonce += 2 * x.size();
+}
+
+
 template <Mode mode>
 std::ostream& operator<<(std::ostream& os, const Share<mode> s) {
   std::uint64_t xs[2];
@@ -6,17 +6,36 @@
 #include "prg.h"
 #include "link.h"
 
+#include <atomic>
 #include <bitset>
+#include <cstdint>
 #include <span>
+#include <vector>
 #include <ostream>
 
 
+// The number of ciphertexts G has sent on this thread since it was
+// initialized. Material sent other than through Share::send and and_gates is
+// added with count_ciphertexts.
 std::size_t n_ciphertexts();
+void count_ciphertexts(std::size_t);
 
 
 Link** the_link();
 
 
+// Each thread counts its own calls to the fixed-key hash, so counting needs no
+// synchronization. total_hashes sums the counters of every thread of a party.
+std::atomic<std::size_t>& register_hash_counter(Mode);
+std::size_t total_hashes(Mode);
+
+template <Mode mode>
+inline void count_hash() {
+  thread_local std::atomic<std::size_t>& counter = register_hash_counter(mode);
+  counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+
 template <Mode mode>
 struct Share {
 public:
@@ -56,10 +75,12 @@ public:
   Share operator|(const Share& o) const { return ~(~(*this) & ~o); }
 
   Share H() const {
+    count_hash<mode>();
     return fixed_key(val ^ std::bitset<128> { nonce });
   }
 
   Share H(std::size_t nonce) const {
+    count_hash<mode>();
     return fixed_key(val ^ std::bitset<128> { nonce });
   }
 
@@ -84,9 +105,41 @@ private:
 };
 
 
+// Computes out[i] = x[i] & y[i] for every i. All of the gates are garbled
+// together and their rows are transferred in a single message.
+// `out` may alias `x` or `y`.
+template <Mode mode>
+void and_gates(
+    std::span<const Share<mode>> x,
+    std::span<const Share<mode>> y,
+    std::span<Share<mode>> out);
+
+
+// Reveals a batch of shares in one message of one bit per share: G sends its
+// colors, and afterwards E's colors hold the semantic values.
+template <Mode mode>
+void reveal(std::span<Share<mode>>);
+
+
+// Output decoding over the link, in one message of one bit per wire. For E to
+// learn the outputs, G sends the colors of its labels; for G to learn them, E
+// sends its colors. The learning party returns the outputs packed eight to a
+// byte; the other party returns nothing.
+//
+// With `check`, the learning party also rejects labels that E could not have
+// reached honestly. G adds, per wire, 64-bit hashes of both labels ordered by
+// color; E adds one 128-bit digest of the hashes of all its labels.
+template <Mode mode>
+std::vector<std::uint8_t> decode_to_evaluator(std::span<const Share<mode>>, bool check = false);
+
+template <Mode mode>
+std::vector<std::uint8_t> decode_to_garbler(std::span<const Share<mode>>, bool check = false);
+
+
 template <Mode mode>
 std::ostream& operator<<(std::ostream&, const Share<mode>);
 
+// Decodes in one process, from both parties' labels, against G's delta.
 bool decode(const Share<Mode::G>&, const Share<Mode::E>&);
 
 
@@ -4,6 +4,7 @@
 
 #include "share.h"
 #include "matrix.h"
+#include "measure_link.h"
 #include <vector>
 #include <span>
 #include <functional>
@@ -206,10 +207,33 @@ public:
   }
 
   void reveal() {
-    for (auto& s: vals) { s.reveal(); }
+    ::reveal<mode>(std::span { vals });
+  }
+
+  // Decodes the whole matrix over the link in one message; see
+  // decode_to_evaluator in share.h. The party that learns nothing gets an
+  // empty matrix.
+  Matrix decode_to_evaluator(bool check = false) const {
+    return unpack(::decode_to_evaluator<mode>(std::span { vals }, check));
+  }
+
+  Matrix decode_to_garbler(bool check = false) const {
+    return unpack(::decode_to_garbler<mode>(std::span { vals }, check));
   }
 
 private:
+  Matrix unpack(const std::vector<std::uint8_t>& bits) const {
+    if (bits.empty()) { return { 0, 0 }; }
+    Matrix out(n, m);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < m; ++j) {
+        const auto k = j*n + i;
+        out(i, j) = (bits[k/8] >> (k%8)) & 1;
+      }
+    }
+    return out;
+  }
+
   Share<mode>& get(std::size_t i, std::size_t j) {
     return vals[j*n + i];
   }
@@ -334,6 +358,15 @@ ShareMatrix<mode> outer_product(
 }
 
 
+// Computes only the cells x[i] & y[j] of the outer product with i + j < w, as
+// needed by a product truncated to w bits. The remaining cells are zero.
+template <Mode mode>
+ShareMatrix<mode> triangle_outer_product(
+    const MatrixView<const Share<mode>>&,
+    const MatrixView<const Share<mode>>&,
+    std::size_t w);
+
+
 // Computes (a + color(a)) x b where x denotes the vector outer product.
 template <Mode mode>
 void half_outer_product(
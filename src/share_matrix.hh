@@ -91,6 +91,54 @@ void outer_product(
 }
 
 
+// Both half outer products are chunked by rows, and each chunk only needs the
+// prefix of the other operand that keeps it inside the triangle, which skips
+// about half of the one-hot work when w is the operand width.
+template <Mode mode>
+ShareMatrix<mode> triangle_outer_product(
+    const MatrixView<const Share<mode>>& X,
+    const MatrixView<const Share<mode>>& Y,
+    std::size_t w) {
+  assert(X.cols() == 1);
+  assert(Y.cols() == 1);
+
+  const auto n = X.rows();
+  const auto m = Y.rows();
+  const auto def = chunking_factor();
+
+  ShareMatrix<mode> out(n, m);
+  MatrixView<Share<mode>> view = out;
+
+  const auto halves = [&](
+      const MatrixView<const Share<mode>>& a,
+      const MatrixView<const Share<mode>>& b,
+      const MatrixView<Share<mode>>& o) {
+    for (std::size_t i0 = 0; i0 < a.rows() && i0 < w; i0 += def) {
+      const auto rows = std::min(def, a.rows() - i0);
+      const auto cols = std::min(b.rows(), w - i0);
+      half_outer_product<mode>(
+          subrows(i0, rows, a), subrows(0, cols, b), o.shift({ i0, 0 }).resize(rows, cols));
+    }
+  };
+
+  const auto cx = color(X);
+  const auto cy = color(Y);
+  halves(X, Y, view);
+  halves(Y, ShareMatrix<mode>::constant(cx), transpose(view));
+
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < m; ++j) {
+      if (i + j < w) {
+        out(i, j) ^= Share<mode>::bit(cx[i] && cy[j]);
+      } else {
+        out(i, j) = Share<mode>::bit(false);
+      }
+    }
+  }
+  return out;
+}
+
+
 /* template ShareMatrix<Mode::G> outer_product(const ShareCSpan<Mode::G>&, const ShareCSpan<Mode::G>&); */
 /* template ShareMatrix<Mode::E> outer_product(const ShareCSpan<Mode::E>&, const ShareCSpan<Mode::E>&); */
 
@@ -132,7 +180,7 @@ ShareMatrix<mode> naive_matrix_multiplication(
 
   ShareMatrix<mode> out(l, m);
   for (std::size_t i = 0; i < n; ++i) {
-    naive_outer_product<mode>(column(i, x), row(i, y), out);
+    out ^= naive_outer_product<mode>(column(i, x), row(i, y));
   }
   return out;
 }
@@ -0,0 +1,220 @@
+#include "shm_link.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+
+
+// The segment starts with one page holding both ring headers, the capacity
+// and a ready word, followed by the data of ring 0 and then ring 1. The ready
+// word is stored last, so a party that opens the segment by name knows the
+// rest of the header is in place once it reads `ready_magic` there.
+constexpr std::size_t capacity_offset = 2*sizeof(RingHeader);
+constexpr std::size_t ready_offset = capacity_offset + sizeof(std::uint64_t);
+constexpr std::uint64_t ready_magic = 0x4b4e494c4d485331;  // "1SHMLINK"
+
+
+// Spins briefly, since the peer is usually about to make progress, and then
+// yields so that a descheduled peer can run.
+template <typename F>
+void spin_until(F ready) {
+  for (std::size_t i = 0; !ready(); ++i) {
+    if (i < 1024) { _mm_pause(); } else { std::this_thread::yield(); }
+  }
+}
+
+
+std::atomic<std::uint64_t>& ready_word(void* header) {
+  return *reinterpret_cast<std::atomic<std::uint64_t>*>(static_cast<std::byte*>(header) + ready_offset);
+}
+
+
+[[noreturn]] void shm_failure(const char* what) {
+  std::cerr << "ERROR: " << what << ": " << std::strerror(errno) << '\n';
+  std::exit(1);
+}
+
+
+std::size_t round_to_pages(std::size_t n, std::size_t page) {
+  return std::max(page, (n + page - 1) / page * page);
+}
+
+
+void initialize_segment(int fd, std::size_t page, std::size_t cap) {
+  if (ftruncate(fd, page + 2*cap) != 0) { shm_failure("ftruncate"); }
+  void* p = mmap(nullptr, page, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) { shm_failure("mmap"); }
+  for (std::size_t r = 0; r < 2; ++r) {
+    auto* h = new (static_cast<RingHeader*>(p) + r) RingHeader;
+    h->head.store(0);
+    h->tail.store(0);
+  }
+  *reinterpret_cast<std::uint64_t*>(static_cast<std::byte*>(p) + capacity_offset) = cap;
+  new (&ready_word(p)) std::atomic<std::uint64_t>;
+  ready_word(p).store(ready_magic, std::memory_order_release);
+  munmap(p, page);
+}
+
+
+ShmSegment::ShmSegment(std::size_t capacity) : page(sysconf(_SC_PAGESIZE)) {
+  cap = round_to_pages(capacity, page);
+#ifdef __linux__
+  descriptor = memfd_create("one-hot-link", 0);
+#else
+  const auto name = "/one-hot-link-" + std::to_string(getpid()) + "-" + std::to_string(reinterpret_cast<std::uintptr_t>(this));
+  descriptor = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  shm_unlink(name.c_str());
+#endif
+  if (descriptor < 0) { shm_failure("memfd_create"); }
+  initialize_segment(descriptor, page, cap);
+  map();
+}
+
+
+// The creator replaces any segment left under the name by an earlier run, so
+// the other party cannot find a stale ready word, and unlinks the name when
+// it is destroyed. The other party may start first, so it retries until the
+// name exists.
+ShmSegment::ShmSegment(const char* name, bool create, std::size_t capacity) : page(sysconf(_SC_PAGESIZE)) {
+  if (create) {
+    shm_unlink(name);
+    descriptor = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  } else {
+    spin_until([&] {
+      descriptor = shm_open(name, O_RDWR, 0600);
+      return descriptor >= 0 || errno != ENOENT;
+    });
+  }
+  if (descriptor < 0) { shm_failure("shm_open"); }
+  if (create) {
+    owned_name = name;
+    cap = round_to_pages(capacity, page);
+    initialize_segment(descriptor, page, cap);
+  }
+  map();
+}
+
+
+ShmSegment::ShmSegment(Descriptor d) : descriptor(d.fd), page(sysconf(_SC_PAGESIZE)) {
+  map();
+}
+
+
+// Reserves one range of address space for the header page and both rings
+// (each twice), then maps the pieces of the segment over it. A segment opened
+// by name may still be being initialized by its creator: touching the header
+// page before `ftruncate` would fault, and the capacity is only meaningful
+// once the ready word is set, so both are waited for.
+void ShmSegment::map() {
+  if (cap == 0) {
+    spin_until([&] {
+      struct stat st;
+      if (fstat(descriptor, &st) != 0) { shm_failure("fstat"); }
+      return static_cast<std::size_t>(st.st_size) >= page;
+    });
+    void* p = mmap(nullptr, page, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (p == MAP_FAILED) { shm_failure("mmap"); }
+    spin_until([&] { return ready_word(p).load(std::memory_order_acquire) == ready_magic; });
+    cap = *reinterpret_cast<const std::uint64_t*>(static_cast<const std::byte*>(p) + capacity_offset);
+    munmap(p, page);
+  }
+
+  mapped = page + 4*cap;
+  void* p = mmap(nullptr, mapped, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) { shm_failure("mmap"); }
+  base = static_cast<std::byte*>(p);
+
+  const auto fixed = [&](std::byte* at, std::size_t size, std::size_t offset) {
+    void* q = mmap(at, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, descriptor, offset);
+    if (q == MAP_FAILED) { shm_failure("mmap"); }
+  };
+  fixed(base, page, 0);
+  for (std::size_t r = 0; r < 2; ++r) {
+    fixed(data(r), cap, page + r*cap);
+    fixed(data(r) + cap, cap, page + r*cap);
+  }
+}
+
+
+ShmSegment::~ShmSegment() {
+  if (base) { munmap(base, mapped); }
+  if (descriptor >= 0) { close(descriptor); }
+  if (!owned_name.empty()) { shm_unlink(owned_name.c_str()); }
+}
+
+
+RingHeader& ShmSegment::header(std::size_t ring) {
+  return reinterpret_cast<RingHeader*>(base)[ring];
+}
+
+
+std::byte* ShmSegment::data(std::size_t ring) {
+  return base + page + 2*cap*ring;
+}
+
+
+ShmLink::ShmLink(ShmSegment& segment, Mode mode)
+  : out(segment.header(mode == Mode::G ? 0 : 1)),
+    in(segment.header(mode == Mode::G ? 1 : 0)),
+    out_data(segment.data(mode == Mode::G ? 0 : 1)),
+    in_data(segment.data(mode == Mode::G ? 1 : 0)),
+    cap(segment.capacity()) { }
+
+
+std::span<std::byte> ShmLink::reserve(std::size_t n) {
+  assert(n <= cap);
+  const auto head = out.head.load(std::memory_order_relaxed);
+  spin_until([&] { return head + n - out.tail.load(std::memory_order_acquire) <= cap; });
+  return { out_data + head % cap, n };
+}
+
+
+void ShmLink::commit(std::size_t n) {
+  out.head.store(out.head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+}
+
+
+std::span<const std::byte> ShmLink::acquire(std::size_t n) {
+  assert(n <= cap);
+  const auto tail = in.tail.load(std::memory_order_relaxed);
+  spin_until([&] { return in.head.load(std::memory_order_acquire) - tail >= n; });
+  return { in_data + tail % cap, n };
+}
+
+
+void ShmLink::release(std::size_t n) {
+  in.tail.store(in.tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+}
+
+
+// Large messages go through the ring in pieces of half its capacity, so that
+// the peer can drain one piece while the next is written.
+void ShmLink::send(std::span<const std::byte> s) {
+  while (!s.empty()) {
+    const auto n = std::min(s.size(), cap / 2);
+    std::memcpy(reserve(n).data(), s.data(), n);
+    commit(n);
+    s = s.subspan(n);
+  }
+}
+
+
+void ShmLink::recv(std::span<std::byte> s) {
+  while (!s.empty()) {
+    const auto n = std::min(s.size(), cap / 2);
+    std::memcpy(s.data(), acquire(n).data(), n);
+    release(n);
+    s = s.subspan(n);
+  }
+}
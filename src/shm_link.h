@@ -0,0 +1,100 @@
+#ifndef SHM_LINK_H__
+#define SHM_LINK_H__
+
+
+#include "link.h"
+#include "mode.h"
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+
+
+// A link between two parties on the same host, through a pair of lock-free
+// single-producer single-consumer rings in shared memory. The segment holding
+// the rings can be shared by threads of one process, or by two processes that
+// open the same POSIX shared memory name (or inherit the same descriptor).
+//
+// Each ring's data pages are mapped twice, back to back, so every reservation
+// is contiguous even when it wraps around the end of the ring. That makes the
+// reserve/commit and acquire/release calls zero-copy: a party writes straight
+// into the ring and its peer reads straight out of it.
+
+
+struct RingHeader {
+  // Both counters only grow; they are reduced modulo the capacity on use.
+  alignas(64) std::atomic<std::uint64_t> head;
+  alignas(64) std::atomic<std::uint64_t> tail;
+};
+
+
+class ShmSegment {
+public:
+  // A fresh anonymous segment, for parties in one process (or a child that
+  // inherits `fd()`). The capacity of each ring is rounded up to whole pages.
+  explicit ShmSegment(std::size_t capacity = 1 << 22);
+
+  // Creates (or opens) the segment with the given POSIX shared memory name.
+  // The creator sets the capacity; the other party waits for the creator to
+  // create and initialize the segment and reads it from there. The creator unlinks the
+  // name on destruction.
+  ShmSegment(const char* name, bool create, std::size_t capacity = 1 << 22);
+
+  // Maps an inherited descriptor of an existing segment. The descriptor is
+  // wrapped so that it cannot be mistaken for a capacity.
+  struct Descriptor { int fd; };
+  explicit ShmSegment(Descriptor);
+
+  ~ShmSegment();
+
+  ShmSegment(const ShmSegment&) = delete;
+  ShmSegment& operator=(const ShmSegment&) = delete;
+
+  int fd() const { return descriptor; }
+  std::size_t capacity() const { return cap; }
+
+  RingHeader& header(std::size_t ring);
+  std::byte* data(std::size_t ring);
+
+private:
+  void map();
+
+  int descriptor = -1;
+  std::string owned_name;
+  std::size_t cap = 0;
+  std::size_t page = 0;
+  std::byte* base = nullptr;
+  std::size_t mapped = 0;
+};
+
+
+class ShmLink : public Link {
+public:
+  // G writes ring 0 and reads ring 1; E does the opposite.
+  ShmLink(ShmSegment& segment, Mode mode);
+
+  void send(std::span<const std::byte>);
+  void recv(std::span<std::byte>);
+  void flush() { }
+
+  // Waits for n free bytes and returns them; nothing is visible to the peer
+  // until `commit`. n must not exceed the capacity.
+  std::span<std::byte> reserve(std::size_t n);
+  void commit(std::size_t n);
+
+  // Waits for n received bytes and returns them; they stay valid until
+  // `release`. n must not exceed the capacity.
+  std::span<const std::byte> acquire(std::size_t n);
+  void release(std::size_t n);
+
+private:
+  RingHeader& out;
+  RingHeader& in;
+  std::byte* out_data;
+  std::byte* in_data;
+  std::size_t cap;
+};
+
+
+#endif
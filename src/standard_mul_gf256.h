@@ -6,22 +6,22 @@
 // See http://cs-www.cs.yale.edu/homes/peralta/CircuitStuff/CMT.html
 template <Mode mode>
 ShareMatrix<mode> standard_mul_gf256(const ShareMatrix<mode>& x, const ShareMatrix<mode>& y) {
-  const auto a7 = x[0];
-  const auto a6 = x[1];
-  const auto a5 = x[2];
-  const auto a4 = x[3];
-  const auto a3 = x[4];
-  const auto a2 = x[5];
-  const auto a1 = x[6];
-  const auto a0 = x[7];
-  const auto b7 = y[0];
-  const auto b6 = y[1];
-  const auto b5 = y[2];
-  const auto b4 = y[3];
-  const auto b3 = y[4];
-  const auto b2 = y[5];
-  const auto b1 = y[6];
-  const auto b0 = y[7];
+  const auto a7 = x[7];
+  const auto a6 = x[6];
+  const auto a5 = x[5];
+  const auto a4 = x[4];
+  const auto a3 = x[3];
+  const auto a2 = x[2];
+  const auto a1 = x[1];
+  const auto a0 = x[0];
+  const auto b7 = y[7];
+  const auto b6 = y[6];
+  const auto b5 = y[5];
+  const auto b4 = y[4];
+  const auto b3 = y[3];
+  const auto b2 = y[2];
+  const auto b1 = y[1];
+  const auto b0 = y[0];
 
   const auto t1 = a0 & b0;
   const auto t2 = a0 & b1;
@@ -150,14 +150,14 @@ ShareMatrix<mode> standard_mul_gf256(const ShareMatrix<mode>& x, const ShareMatr
   const auto c0 = t117;
 
   ShareMatrix<mode> out(8, 1);
-  out[7] = c0;
-  out[6] = c1;
-  out[5] = c2;
-  out[4] = c3;
-  out[3] = c4;
-  out[2] = c5;
-  out[1] = c6;
-  out[0] = c7;
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+  out[4] = c4;
+  out[5] = c5;
+  out[6] = c6;
+  out[7] = c7;
 
   return out;
 }
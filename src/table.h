@@ -2,6 +2,10 @@
 #define TABLE_H__
 
 
+#include <vector>
+#include <cstddef>
+
+
 struct Table {
   // get ith row of the table; max size of a table row is given by std::size_t
   virtual std::size_t operator()(std::size_t i) const = 0;
@@ -9,4 +13,29 @@ struct Table {
 };
 
 
+// A table from n bits to m bits given by its explicit list of rows.
+struct ExplicitTable : public Table {
+  ExplicitTable() { }
+  ExplicitTable(std::size_t n, std::size_t m, std::vector<std::size_t> rows)
+    : n(n), m(m), rows(std::move(rows)) { }
+
+  std::size_t operator()(std::size_t i) const {
+    return rows[i];
+  }
+
+  std::size_t n;
+  std::size_t m;
+  std::vector<std::size_t> rows;
+};
+
+
+// Row i is the one-hot encoding of i, so a lookup in this table produces the
+// unary vector U(i). Inputs are limited to 6 bits.
+struct UnaryTable : public Table {
+  std::size_t operator()(std::size_t i) const {
+    return std::size_t { 1 } << i;
+  }
+};
+
+
 #endif
@@ -0,0 +1,51 @@
+#ifndef TRANSCRIPT_LINK_H__
+#define TRANSCRIPT_LINK_H__
+
+
+#include "link.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+
+// Holds G's transcript in one contiguous in-memory arena. G garbles a whole
+// workload into the link, then E evaluates it from the same link, on the same
+// thread, with no socket in between; garbling and evaluation can be timed
+// separately, and their cost is pure computation.
+class TranscriptLink : public Link {
+public:
+  TranscriptLink(std::size_t capacity = 0) { arena.reserve(capacity); }
+
+  void send(std::span<const std::byte> s) {
+    arena.insert(arena.end(), s.begin(), s.end());
+  }
+
+  void recv(std::span<std::byte> s) {
+    if (s.size() > arena.size() - pos) {
+      std::cerr << "ERROR: E read past the end of the transcript\n";
+      std::exit(1);
+    }
+    std::memcpy(s.data(), arena.data() + pos, s.size());
+    pos += s.size();
+  }
+
+  std::size_t size() const { return arena.size(); }
+  std::size_t remaining() const { return arena.size() - pos; }
+
+  // Replays the transcript from the start, e.g. to evaluate it again.
+  void rewind() { pos = 0; }
+
+  // Drops the transcript but keeps the arena's memory for the next one.
+  void clear() {
+    arena.clear();
+    pos = 0;
+  }
+
+private:
+  std::vector<std::byte> arena;
+  std::size_t pos = 0;
+};
+
+
+#endif
@@ -1,7 +1,10 @@
 #include "unary_outer_product.h"
+#include "measure_link.h"
 #include <condition_variable>
 #include <thread>
 #include <iostream>
+#include <array>
+#include <type_traits>
 
 
 template <Mode mode>
@@ -47,7 +50,7 @@ std::vector<Share<mode>> populate_seeds(
       Share<mode> evens = std::bitset<128> { 0 };
       // Work backwards across the level so as to not overwrite the parent seed
       // until it is no longer needed.
-      for (int j = (1 << (i-1)); j >= 0; --j) {
+      for (int j = (1 << i) - 1; j >= 0; --j) {
         seeds[j*2 + 1] = seeds[j].H(0);
         seeds[j*2] = seeds[j].H(1);
         evens ^= seeds[j*2];
@@ -66,7 +69,7 @@ std::vector<Share<mode>> populate_seeds(
       Share<mode> e_evens = std::bitset<128> { 0 };
       Share<mode> e_odds = std::bitset<128> { 0 };
 
-      for (int j = (1 << (i-1)); j >= 0; --j) {
+      for (int j = (1 << i) - 1; j >= 0; --j) {
         if (j != missing) {
           seeds[j*2 + 1] = seeds[j].H(0);
           seeds[j*2] = seeds[j].H(1);
@@ -91,19 +94,33 @@ std::vector<Share<mode>> populate_seeds(
 
 
 // multithreading coordiation
-std::size_t njobs;
+std::size_t default_njobs = 4;
 
-std::vector<std::thread> g_threads;
+std::size_t& worker_threads() {
+  return default_njobs;
+}
+
+std::size_t g_njobs;
+std::size_t e_njobs;
+
+// With a striped transport, worker k streams its slice of every product over
+// channel k; otherwise the calling thread moves all messages over its link.
+std::vector<Link*> g_channels;
+std::vector<Link*> e_channels;
+
+// The threads and condition variables are never destroyed, so that a party
+// that exits on an error while its workers wait does not hang or abort.
+std::vector<std::thread>& g_threads = *new std::vector<std::thread>;
 std::vector<int> g_ready;
 std::atomic<int> g_finished_job_counter;
-std::condition_variable g_cv;
+std::condition_variable& g_cv = *new std::condition_variable;
 std::mutex g_mutex;
 bool g_done;
 
-std::vector<std::thread> e_threads;
+std::vector<std::thread>& e_threads = *new std::vector<std::thread>;
 std::vector<int> e_ready;
 std::atomic<int> e_finished_job_counter;
-std::condition_variable e_cv;
+std::condition_variable& e_cv = *new std::condition_variable;
 std::mutex e_mutex;
 bool e_done;
 
@@ -116,6 +133,7 @@ struct GCtxt {
   const MatrixView<Share<Mode::G>>* out;
   const MatrixView<const Share<Mode::G>>* y;
   const Table* f;
+  bool shift;
 };
 
 
@@ -124,6 +142,7 @@ GCtxt gctxt;
 struct GJob {
   std::size_t start;
   std::size_t stop;
+  Link* channel;
 
   void operator()() const {
     const auto n = gctxt.n;
@@ -133,14 +152,17 @@ struct GJob {
       for (std::size_t i = 0; i < (1 << n); ++i) {
         const auto s = gctxt.seeds[i].H(Share<Mode::G>::nonce + (1 << n)*j + i);
         sum ^= s;
-        std::size_t frow = (*gctxt.f)(i);
+        std::size_t frow = (*gctxt.f)(gctxt.shift ? i ^ j : i);
         for (std::size_t k = 0; k < l; ++k) {
-          if (frow & (1 << k)) { (*gctxt.out)(k, j) ^= s; }
+          if ((frow >> k) & 1) { (*gctxt.out)(k, j) ^= s; }
         }
       }
       sum ^= (*gctxt.y)[j];
       gctxt.messages[j] = sum;
     }
+    if (channel && start < stop) {
+      channel->send(std::as_bytes(gctxt.messages.subspan(start, stop - start)));
+    }
   }
 };
 
@@ -161,20 +183,21 @@ void gjob(std::size_t job_number) {
 }
 
 
-void initialize_gjobs() {
+void initialize_gjobs(std::vector<Link*> channels) {
   g_done = false;
   /* njobs = std::thread::hardware_concurrency(); */
-  njobs = 4;
-  gjobs.resize(njobs);
-  g_ready.resize(njobs);
+  g_njobs = channels.empty() ? worker_threads() : channels.size();
+  g_channels = std::move(channels);
+  gjobs.resize(g_njobs);
+  g_ready.resize(g_njobs);
   g_threads.resize(0);
-  for (std::size_t i = 0; i < njobs; ++i) {
+  for (std::size_t i = 0; i < g_njobs; ++i) {
     g_threads.emplace_back([i] { gjob(i); });
   }
 
-  int expected = njobs;
+  int expected = g_njobs;
   while(!atomic_compare_exchange_strong(&g_finished_job_counter, &expected, 0)) {
-    expected = njobs;
+    expected = g_njobs;
     // wait until all jobs start
   }
 }
@@ -183,6 +206,8 @@ void finalize_gjobs() {
   g_done = true;
   g_cv.notify_all();
   for (auto& th: g_threads) { th.join(); }
+  for (auto* c: g_channels) { c->flush(); }
+  g_channels.clear();
 }
 
 
@@ -196,6 +221,7 @@ struct ECtxt {
   const MatrixView<Share<Mode::E>>* out;
   const MatrixView<const Share<Mode::E>>* y;
   const Table* f;
+  bool shift;
 };
 
 
@@ -205,10 +231,14 @@ ECtxt ectxt;
 struct EJob {
   std::size_t start;
   std::size_t stop;
+  Link* channel;
 
   void operator()() const {
     const auto n = ectxt.n;
     const auto l = ectxt.l;
+    if (channel && start < stop) {
+      channel->recv(std::as_writable_bytes(ectxt.messages.subspan(start, stop - start)));
+    }
     for (std::size_t j = start; j < stop; ++j) {
       const Share<Mode::E> g_sum = ectxt.messages[j];
       Share<Mode::E> e_sum = std::bitset<128> { 0 };
@@ -216,16 +246,16 @@ struct EJob {
         if (i != ectxt.missing) {
           const auto s = ectxt.seeds[i].H(Share<Mode::E>::nonce + (1 << n)*j + i);
           e_sum ^= s;
-          std::size_t frow = (*ectxt.f)(i);
+          std::size_t frow = (*ectxt.f)(ectxt.shift ? i ^ j : i);
           for (std::size_t k = 0; k < l; ++k) {
-            if (frow & (1 << k)) { (*ectxt.out)(k, j) ^= s; }
+            if ((frow >> k) & 1) { (*ectxt.out)(k, j) ^= s; }
           }
         }
       }
       const auto s = e_sum ^ g_sum ^ (*ectxt.y)[j];
-      std::size_t frow = (*ectxt.f)(ectxt.missing);
+      std::size_t frow = (*ectxt.f)(ectxt.shift ? ectxt.missing ^ j : ectxt.missing);
       for (std::size_t k = 0; k < l; ++k) {
-        if (frow & (1 << k)) { (*ectxt.out)(k, j) ^= s; }
+        if ((frow >> k) & 1) { (*ectxt.out)(k, j) ^= s; }
       }
     }
   }
@@ -248,20 +278,21 @@ void ejob(std::size_t job_number) {
 }
 
 
-void initialize_ejobs() {
+void initialize_ejobs(std::vector<Link*> channels) {
   e_done = false;
   /* njobs = std::thread::hardware_concurrency(); */
-  njobs = 4;
-  ejobs.resize(njobs);
-  e_ready.resize(njobs);
+  e_njobs = channels.empty() ? worker_threads() : channels.size();
+  e_channels = std::move(channels);
+  ejobs.resize(e_njobs);
+  e_ready.resize(e_njobs);
   e_threads.resize(0);
-  for (std::size_t i = 0; i < njobs; ++i) {
+  for (std::size_t i = 0; i < e_njobs; ++i) {
     e_threads.emplace_back([i] { ejob(i); });
   }
 
-  int expected = njobs;
+  int expected = e_njobs;
   while(!atomic_compare_exchange_strong(&e_finished_job_counter, &expected, 0)) {
-    expected = njobs;
+    expected = e_njobs;
     // wait until all jobs start
   }
 }
@@ -270,12 +301,116 @@ void finalize_ejobs() {
   e_done = true;
   e_cv.notify_all();
   for (auto& th: e_threads) { th.join(); }
+  e_channels.clear();
+}
+
+
+// Small products (e.g. the 8x8 products in GF(256)) do far less work than it
+// costs to wake the workers, so they run on the calling thread instead. The
+// inline kernel reads the table once per product, accumulates each output
+// column in registers, and is instantiated with n, m and l fixed at compile
+// time for the common shapes so that its loops unroll. A template argument of
+// 0 means the corresponding dimension is only known at runtime.
+//
+// bench/crossover puts the inline kernel at about half the threaded time up to
+// 2^12 hashes (76 against 132 us for the 8x8 product in gf256_invert, 2^11), so
+// that is the default; larger products go to the workers, where more cores
+// can take a share of them.
+std::size_t inline_work = 1 << 12;
+
+std::size_t& inline_threshold() {
+  return inline_work;
+}
+
+
+constexpr std::size_t max_inline_bits = 8;
+constexpr std::size_t max_inline_rows = 64;
+
+
+bool runs_inline(std::size_t n, std::size_t m, std::size_t l) {
+  return n <= max_inline_bits && l <= max_inline_rows && (m << n) <= inline_threshold();
+}
+
+
+template <Mode mode>
+using Ctxt = std::conditional_t<mode == Mode::G, GCtxt, ECtxt>;
+
+
+template <Mode mode, std::size_t N, std::size_t M, std::size_t L>
+void inline_job(const Ctxt<mode>& ctxt) {
+  const std::size_t n = N ? N : ctxt.n;
+  const std::size_t m = M ? M : ctxt.messages.size();
+  const std::size_t l = L ? L : ctxt.l;
+
+  std::array<std::size_t, 1 << max_inline_bits> frows;
+  for (std::size_t i = 0; i < (std::size_t { 1 } << n); ++i) { frows[i] = (*ctxt.f)(i); }
+
+  for (std::size_t j = 0; j < m; ++j) {
+    std::array<Share<mode>, max_inline_rows> acc;
+    for (std::size_t k = 0; k < l; ++k) { acc[k] = std::bitset<128> { 0 }; }
+
+    const auto accumulate = [&](std::size_t i, const Share<mode>& s) {
+      const auto frow = frows[ctxt.shift ? i ^ j : i];
+      for (std::size_t k = 0; k < l; ++k) {
+        if ((frow >> k) & 1) { acc[k] ^= s; }
+      }
+    };
+
+    Share<mode> sum = std::bitset<128> { 0 };
+    for (std::size_t i = 0; i < (std::size_t { 1 } << n); ++i) {
+      if constexpr (mode == Mode::E) {
+        if (i == ctxt.missing) { continue; }
+      }
+      const auto s = ctxt.seeds[i].H(Share<mode>::nonce + (1 << n)*j + i);
+      sum ^= s;
+      accumulate(i, s);
+    }
+
+    if constexpr (mode == Mode::G) {
+      ctxt.messages[j] = sum ^ (*ctxt.y)[j];
+    } else {
+      accumulate(ctxt.missing, sum ^ ctxt.messages[j] ^ (*ctxt.y)[j]);
+    }
+
+    for (std::size_t k = 0; k < l; ++k) { (*ctxt.out)(k, j) ^= acc[k]; }
+  }
+}
+
+
+template <Mode mode, std::size_t M, std::size_t N = 1>
+void dispatch_inline_job(const Ctxt<mode>& ctxt) {
+  if constexpr (N > max_inline_bits) {
+    inline_job<mode, 0, M, 0>(ctxt);
+  } else {
+    if (ctxt.n != N) {
+      dispatch_inline_job<mode, M, N+1>(ctxt);
+    } else if (ctxt.l == N) {
+      inline_job<mode, N, M, N>(ctxt);
+    } else if (ctxt.l == 8) {
+      inline_job<mode, N, M, 8>(ctxt);
+    } else {
+      inline_job<mode, N, M, 0>(ctxt);
+    }
+  }
+}
+
+
+template <Mode mode>
+void run_inline(const Ctxt<mode>& ctxt) {
+  switch (ctxt.messages.size()) {
+    case 1: dispatch_inline_job<mode, 1>(ctxt); break;
+    case 8: dispatch_inline_job<mode, 8>(ctxt); break;
+    default: dispatch_inline_job<mode, 0>(ctxt); break;
+  }
 }
 
 
+// When `shift` is set, column j of the product uses the table i -> f(i + j)
+// rather than f itself.
 template <Mode mode>
 void unary_outer_product(
     const Table& f,
+    bool shift,
     const MatrixView<const Share<mode>>& x,
     const MatrixView<const Share<mode>>& y,
     const MatrixView<Share<mode>>& out) {
@@ -288,64 +423,127 @@ void unary_outer_product(
   const auto l = out.rows();
   assert(out.cols() == m);
 
+  Phase phase { "seed tree" };
   std::size_t missing = 0;
   const auto seeds = populate_seeds<mode>(x, missing);
+  Phase products { "outer product" };
 
   // Now we are ready to compute the outer product.
   // For each share (B, B + bDelta)
   // G sends the sum (XOR_i A_i) + B, which allows E to obtain A_{x + gamma} + bDelta
   if constexpr (mode == Mode::G) {
     std::vector<Share<mode>> messages(m);
-    gctxt = { n, l, seeds, messages, &out, &y, &f };
+    const GCtxt ctxt { n, l, seeds, messages, &out, &y, &f, shift };
+
+    const bool striped = !runs_inline(n, m, l) && !g_channels.empty();
+    if (runs_inline(n, m, l)) {
+      run_inline<mode>(ctxt);
+    } else {
+      gctxt = ctxt;
 
-    {
       std::unique_lock<std::mutex> lock(g_mutex);
-      for (std::size_t jb = 0; jb < njobs; ++jb) {
-        const std::size_t slice = (m + njobs - 1)/njobs;
+      for (std::size_t jb = 0; jb < g_njobs; ++jb) {
+        const std::size_t slice = (m + g_njobs - 1)/g_njobs;
         const std::size_t start = jb*slice;
         const std::size_t stop = std::min((jb+1)*slice, m);
 
-        GJob job { start, stop };
+        GJob job { start, stop, striped ? g_channels[jb] : nullptr };
         gjobs[jb] = job;
         g_ready[jb] = 1;
       }
+      lock.unlock();
+
+      // dispatch jobs
+      g_cv.notify_all();
+      int expected = g_njobs;
+      while(!atomic_compare_exchange_strong(&g_finished_job_counter, &expected, 0)) {
+        expected = g_njobs;
+        // wait until all jobs finish
+      }
     }
 
-    // dispatch jobs
-    g_cv.notify_all();
-    int expected = njobs;
-    while(!atomic_compare_exchange_strong(&g_finished_job_counter, &expected, 0)) {
-      expected = njobs;
-      // wait until all jobs finish
+    if (!striped) {
+      for (auto& m: messages) { m.send(); }
+    } else {
+      count_ciphertexts(m);
     }
-
-    for (auto& m: messages) { m.send(); }
   } else {
+    const bool striped = !runs_inline(n, m, l) && !e_channels.empty();
     std::vector<Share<mode>> messages(m);
-    for (auto& m: messages) { m = Share<mode>::recv(); }
-    ectxt = { missing, n, l, seeds, messages, &out, &y, &f };
+    if (!striped) {
+      for (auto& m: messages) { m = Share<mode>::recv(); }
+    }
+    const ECtxt ctxt { missing, n, l, seeds, messages, &out, &y, &f, shift };
+
+    if (runs_inline(n, m, l)) {
+      run_inline<mode>(ctxt);
+    } else {
+      ectxt = ctxt;
 
-    {
       std::unique_lock<std::mutex> lock(e_mutex);
-      for (std::size_t jb = 0; jb < njobs; ++jb) {
-        const std::size_t slice = (m + njobs - 1)/njobs;
+      for (std::size_t jb = 0; jb < e_njobs; ++jb) {
+        const std::size_t slice = (m + e_njobs - 1)/e_njobs;
         const std::size_t start = jb*slice;
         const std::size_t stop = std::min((jb+1)*slice, m);
-        EJob job { start, stop };
+        EJob job { start, stop, striped ? e_channels[jb] : nullptr };
         ejobs[jb] = job;
         e_ready[jb] = 1;
       }
+      lock.unlock();
+
+      // dispatch jobs
+      e_cv.notify_all();
+      int expected = e_njobs;
+      while(!atomic_compare_exchange_strong(&e_finished_job_counter, &expected, 0)) {
+        expected = e_njobs;
+        // wait until all jobs finish
+      }
     }
+  }
+  Share<mode>::nonce += (1<<n)*m;
+}
+
+
+template <Mode mode>
+void unary_outer_product(
+    const Table& f,
+    const MatrixView<const Share<mode>>& x,
+    const MatrixView<const Share<mode>>& y,
+    const MatrixView<Share<mode>>& out) {
+  unary_outer_product<mode>(f, false, x, y, out);
+}
+
+
+template <Mode mode>
+ShareMatrix<mode> lookup(
+    const Table& f,
+    std::size_t l,
+    const MatrixView<const Share<mode>>& x) {
+  assert(x.cols() == 1);
+  const auto n = x.rows();
+
+  // The one-hot product selects row x + c of the table, where c is G's color
+  // of x. G knows c, so G supplies U(c) as its own input and column j of the
+  // product uses the table shifted by j. Only column c contributes, and
+  // summing the columns yields f((x + c) + c) = f(x).
+  auto onehot = Matrix::vector(1 << n);
+  if constexpr (mode == Mode::G) {
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < n; ++i) { c |= std::size_t { x[i].color() } << i; }
+    onehot[c] = 1;
+  }
+  const auto correction = ShareMatrix<mode>::constant(onehot);
+
+  ShareMatrix<mode> wide(l, 1 << n);
+  unary_outer_product<mode>(f, true, x, correction, wide);
 
-    // dispatch jobs
-    e_cv.notify_all();
-    int expected = njobs;
-    while(!atomic_compare_exchange_strong(&e_finished_job_counter, &expected, 0)) {
-      expected = njobs;
-      // wait until all jobs finish
+  auto out = ShareMatrix<mode>::vector(l);
+  for (std::size_t j = 0; j < (std::size_t { 1 } << n); ++j) {
+    for (std::size_t k = 0; k < l; ++k) {
+      out[k] ^= wide(k, j);
     }
   }
-  Share<mode>::nonce += (1<<n)*m;
+  return out;
 }
 
 
@@ -360,3 +558,9 @@ template void unary_outer_product(
     const MatrixView<const Share<Mode::E>>&,
     const MatrixView<const Share<Mode::E>>&,
     const MatrixView<Share<Mode::E>>&);
+
+
+template ShareMatrix<Mode::G> lookup(
+    const Table&, std::size_t, const MatrixView<const Share<Mode::G>>&);
+template ShareMatrix<Mode::E> lookup(
+    const Table&, std::size_t, const MatrixView<const Share<Mode::E>>&);
@@ -20,8 +20,37 @@ void unary_outer_product(
     const MatrixView<const Share<mode>>&,
     const MatrixView<Share<mode>>&);
 
-void initialize_gjobs();
-void initialize_ejobs();
+
+// Let f be a function from n bits to l bits.
+//
+// This computes [| f(x) |] for a public table f and secret x. Unlike
+// `unary_outer_product`, the color of x is corrected internally, so no part of
+// x needs to be revealed. The cost is 2^n ciphertexts and 2^(2n) hashes.
+template <Mode mode>
+ShareMatrix<mode> lookup(
+    const Table&,
+    std::size_t,
+    const MatrixView<const Share<mode>>&);
+
+template <Mode mode>
+ShareMatrix<mode> lookup(const ExplicitTable& f, const ShareMatrix<mode>& x) {
+  assert(x.rows() == f.n);
+  return lookup<mode>(f, f.m, x);
+}
+
+// One-hot products with at most this many (2^n * m) hashes run inline on the
+// calling thread rather than being dispatched to the worker threads.
+std::size_t& inline_threshold();
+
+// The number of worker threads a party starts when it has no channels.
+std::size_t& worker_threads();
+
+// Starts the worker threads of a party. Given channels, the party uses one
+// worker per channel, and each worker streams its slice of every one-hot
+// product over its own channel rather than through the calling thread's link.
+// Both parties must use the same number of channels, connected in order.
+void initialize_gjobs(std::vector<Link*> channels = { });
+void initialize_ejobs(std::vector<Link*> channels = { });
 void finalize_gjobs();
 void finalize_ejobs();
 